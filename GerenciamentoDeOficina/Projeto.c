@@ -1,7 +1,27 @@
+#ifndef _WIN32
+    #define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stddef.h>
+#include <time.h>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <windows.h>
+#else
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <signal.h>
+    #include <unistd.h>
+    #include <pthread.h>
+    #include <sys/mman.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+#endif
 
 // --- Estruturas de Dados ---
 
@@ -36,25 +56,52 @@ typedef struct {
 
 // --- Funcoes Utilitarias ---
 
+// Desligado no modo de linha de comando: sem limpar a tela e sem esperar Enter.
+static int modoInterativo = 1;
+
 void limparBuffer() {
     int c;
     while ((c = getchar()) != '\n' && c != EOF);
 }
 
-void limparTela() {
+// Cada tela e montada inteira no buffer da saida padrao e enviada ao terminal
+// de uma vez, so quando o programa vai esperar uma entrada (exibirTela). A
+// limpeza usa sequencias de escape em vez de chamar "clear"/"cls" no shell.
+#define TELA_BUFFER (64 * 1024)
+#define TELA_LIMPAR "\033[H\033[2J\033[3J"
+
+static char bufferTela[TELA_BUFFER];
+
+void iniciarTela() {
     #ifdef _WIN32
-        system("cls");
-    #else
-        system("clear");
+        #ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+            #define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+        #endif
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD modo;
+        if (GetConsoleMode(console, &modo)) SetConsoleMode(console, modo | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
     #endif
+    setvbuf(stdout, bufferTela, _IOFBF, sizeof(bufferTela));
+}
+
+void exibirTela() {
+    fflush(stdout);
+}
+
+void limparTela() {
+    if (!modoInterativo) return;
+    fputs(TELA_LIMPAR, stdout);
 }
 
 void pausarSistema() {
+    if (!modoInterativo) return;
     printf("\nPressione Enter para continuar...");
+    exibirTela();
     getchar();
 }
 
 int lerString(char* buffer, int tamanho) {
+    exibirTela();
     if (fgets(buffer, tamanho, stdin) == NULL) {
         buffer[0] = '\0';
         return 1; 
@@ -92,6 +139,91 @@ int validarPlaca(const char* placa) {
     return 1;
 }
 
+// Datas compactas: numero de dias contados a partir de 01/01/0001 (dia 1), no
+// calendario gregoriano. Ordenam como inteiro e a diferenca entre duas datas
+// e a distancia em dias; 0 fica reservado para "sem data".
+static int anoBissexto(int ano) {
+    return (ano % 4 == 0 && ano % 100 != 0) || ano % 400 == 0;
+}
+
+static int diasNoMes(int mes, int ano) {
+    static const int dias[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return mes == 2 && anoBissexto(ano) ? 29 : dias[mes - 1];
+}
+
+int diasDaData(int dia, int mes, int ano) {
+    static const int antesDoMes[] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+    int anteriores = ano - 1;
+    int dias = anteriores * 365 + anteriores / 4 - anteriores / 100 + anteriores / 400;
+    dias += antesDoMes[mes - 1] + (mes > 2 && anoBissexto(ano)) + dia;
+    return dias;
+}
+
+// Valida DD/MM/AAAA (inclusive o dia do mes e anos bissextos) e converte.
+int converterData(const char* texto, int* dias) {
+    if (strlen(texto) != 10 || texto[2] != '/' || texto[5] != '/') return 0;
+    for (int i = 0; i < 10; i++) {
+        if (i != 2 && i != 5 && !isdigit((unsigned char)texto[i])) return 0;
+    }
+    int dia = atoi(texto);
+    int mes = atoi(texto + 3);
+    int ano = atoi(texto + 6);
+    if (ano < 1 || mes < 1 || mes > 12 || dia < 1 || dia > diasNoMes(mes, ano)) return 0;
+    *dias = diasDaData(dia, mes, ano);
+    return 1;
+}
+
+// Caminho inverso de converterData; 'texto' precisa de 11 bytes.
+void formatarData(int dias, char* texto) {
+    int ano = (int)((long long)dias * 400 / 146097) + 1;
+    while (ano > 1 && diasDaData(1, 1, ano) > dias) ano--;
+    while (diasDaData(1, 1, ano + 1) <= dias) ano++;
+    int mes = 1;
+    while (mes < 12 && diasDaData(1, mes + 1, ano) <= dias) mes++;
+    unsigned int dia = (unsigned int)(dias - diasDaData(1, mes, ano) + 1);
+    snprintf(texto, 11, "%02u/%02u/%04u", dia % 32u, (unsigned int)mes % 13u, (unsigned int)ano % 10000u);
+}
+
+int dataDeHoje() {
+    time_t agora = time(NULL);
+    struct tm local;
+    #ifdef _WIN32
+        localtime_s(&local, &agora);
+    #else
+        localtime_r(&agora, &local);
+    #endif
+    return diasDaData(local.tm_mday, local.tm_mon + 1, local.tm_year + 1900);
+}
+
+// CRC-32 (polinomio refletido 0xEDB88320), usado para detectar registros
+// corrompidos ou gravados pela metade.
+unsigned int calcularCRC32(unsigned int crc, const void* dados, size_t tamanho) {
+    static unsigned int tabela[256];
+    static int tabelaPronta = 0;
+    if (!tabelaPronta) {
+        for (unsigned int i = 0; i < 256; i++) {
+            unsigned int valor = i;
+            for (int bit = 0; bit < 8; bit++) valor = (valor & 1) ? (valor >> 1) ^ 0xEDB88320u : valor >> 1;
+            tabela[i] = valor;
+        }
+        tabelaPronta = 1;
+    }
+    const unsigned char* bytes = dados;
+    crc = ~crc;
+    for (size_t i = 0; i < tamanho; i++) crc = tabela[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Descarrega o buffer do FILE e pede ao sistema que grave no disco.
+int sincronizarArquivo(FILE* arquivo) {
+    if (fflush(arquivo) != 0) return 0;
+    #ifdef _WIN32
+        return _commit(_fileno(arquivo)) == 0;
+    #else
+        return fsync(fileno(arquivo)) == 0;
+    #endif
+}
+
 int validarNome(const char* nome) {
     if (strlen(nome) == 0) return 0;
     for (int i = 0; nome[i] != '\0'; i++) {
@@ -102,237 +234,3915 @@ int validarNome(const char* nome) {
     return 1;
 }
 
+// Tokenizador da busca textual: termos sao sequencias de letras e digitos,
+// em minusculas e sem acentos ("Embreagem", "EMBREAGEM" e a grafia acentuada viram
+// "embreagem"). Aceita texto em UTF-8 ou Latin-1; termos de uma letra so sao
+// ignorados e os longos sao truncados em TERMO_MAXIMO.
+#define TERMO_MINIMO 2
+#define TERMO_MAXIMO 31
 
-// --- Funcoes de Banco de Dados (Arquivos) ---
+// Letra base de um caractere Latin-1 (0 se nao for letra nem digito).
+static char dobrarCaractere(int c) {
+    static const char acentuados[] = "aaaaaaaceeeeiiiidnooooo ouuuuyty";
+    if (c < 0x80) return isalnum(c) ? (char)tolower(c) : 0;
+    if (c == 0xDF) return 's';
+    if (c < 0xC0 || acentuados[c & 0x1F] == ' ') return 0;
+    return acentuados[c & 0x1F];
+}
 
-void carregarDados(const char* nomeArquivo, void** dados, int* total, size_t tamanhoElemento) {
-    FILE* arquivo = fopen(nomeArquivo, "rb");
-    if (arquivo == NULL) {
-        *total = 0;
-        *dados = NULL;
-        return;
+// Le um caractere (UTF-8 ou Latin-1) e devolve sua letra base, ou 0.
+static char proximaLetra(const unsigned char** texto) {
+    const unsigned char* p = *texto;
+    int c = *p++;
+    if (c >= 0xC2 && c <= 0xF4 && (*p & 0xC0) == 0x80) {
+        // UTF-8: so o bloco Latin-1 (C2/C3) tem letras que sabemos dobrar.
+        int letra = (c == 0xC2 || c == 0xC3) ? ((c & 0x03) << 6) | (*p & 0x3F) : 0;
+        while ((*p & 0xC0) == 0x80) p++;
+        c = letra;
     }
+    *texto = p;
+    return dobrarCaractere(c);
+}
 
-    if (fread(total, sizeof(int), 1, arquivo) != 1) {
-        *total = 0;
-        *dados = NULL;
-        fclose(arquivo);
-        return;
+// Le o proximo termo de '*texto' para 'termo' (TERMO_MAXIMO + 1 bytes) e
+// avanca o ponteiro. Retorna 0 quando o texto acaba.
+int proximoTermo(const char** texto, char* termo) {
+    const unsigned char* p = (const unsigned char*)*texto;
+    int tamanho = 0;
+    while (*p != '\0') {
+        char letra = proximaLetra(&p);
+        if (letra != 0) {
+            if (tamanho < TERMO_MAXIMO) termo[tamanho++] = letra;
+            continue;
+        }
+        if (tamanho >= TERMO_MINIMO) break;
+        tamanho = 0;
     }
-    
-    if (*total < 0 || *total > 10000) {
-        printf("Aviso: Arquivo '%s' corrompido. Iniciando com base limpa.\n", nomeArquivo);
-        pausarSistema();
-        *total = 0;
-        *dados = NULL;
-        fclose(arquivo);
-        return;
+    *texto = (const char*)p;
+    if (tamanho < TERMO_MINIMO) return 0;
+    termo[tamanho] = '\0';
+    return 1;
+}
+
+// Forma normalizada de um nome para comparacao: letras sem acento e em
+// minusculas, palavras separadas por um unico espaco. 'chave' precisa ter
+// pelo menos o tamanho de 'texto' mais 1.
+void normalizarTexto(const char* texto, char* chave) {
+    const unsigned char* p = (const unsigned char*)texto;
+    int tamanho = 0;
+    while (*p != '\0') {
+        char letra = proximaLetra(&p);
+        if (letra != 0) chave[tamanho++] = letra;
+        else if (tamanho > 0 && chave[tamanho - 1] != ' ') chave[tamanho++] = ' ';
     }
-    
-    if (*total == 0) {
-        *dados = NULL;
-        fclose(arquivo);
-        return;
+    if (tamanho > 0 && chave[tamanho - 1] == ' ') tamanho--;
+    chave[tamanho] = '\0';
+}
+
+
+// --- Travas e Threads ---
+
+// Envoltorio minimo sobre pthreads e a API do Windows, usado na abertura para
+// carregar e indexar as tabelas em paralelo.
+#ifdef _WIN32
+    typedef CRITICAL_SECTION Trava;
+    typedef HANDLE Thread;
+    typedef LPTHREAD_START_ROUTINE RotinaThread;
+    #define ROTINA_THREAD DWORD WINAPI
+#else
+    typedef pthread_mutex_t Trava;
+    typedef pthread_t Thread;
+    typedef void* (*RotinaThread)(void*);
+    #define ROTINA_THREAD void*
+#endif
+
+void travaIniciar(Trava* trava) {
+    #ifdef _WIN32
+        InitializeCriticalSection(trava);
+    #else
+        pthread_mutex_init(trava, NULL);
+    #endif
+}
+
+void travaDestruir(Trava* trava) {
+    #ifdef _WIN32
+        DeleteCriticalSection(trava);
+    #else
+        pthread_mutex_destroy(trava);
+    #endif
+}
+
+void travaObter(Trava* trava) {
+    #ifdef _WIN32
+        EnterCriticalSection(trava);
+    #else
+        pthread_mutex_lock(trava);
+    #endif
+}
+
+void travaLiberar(Trava* trava) {
+    #ifdef _WIN32
+        LeaveCriticalSection(trava);
+    #else
+        pthread_mutex_unlock(trava);
+    #endif
+}
+
+// Retorna 0 se a thread nao pode ser criada; quem chama executa a rotina
+// diretamente nesse caso.
+int threadIniciar(Thread* thread, RotinaThread rotina, void* argumento) {
+    #ifdef _WIN32
+        *thread = CreateThread(NULL, 0, rotina, argumento, 0, NULL);
+        return *thread != NULL;
+    #else
+        return pthread_create(thread, NULL, rotina, argumento) == 0;
+    #endif
+}
+
+void threadAguardar(Thread thread) {
+    #ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    #else
+        pthread_join(thread, NULL);
+    #endif
+}
+
+#define PARALELO_MAXIMO 4
+
+// Executa rotinas[i](argumentos[i]) para cada i (ate PARALELO_MAXIMO) em
+// paralelo e so retorna quando todas terminarem. A ultima roda na propria
+// thread de quem chama.
+void executarEmParalelo(RotinaThread* rotinas, void** argumentos, int total) {
+    Thread threads[PARALELO_MAXIMO];
+    int iniciadas[PARALELO_MAXIMO] = { 0 };
+    if (total > PARALELO_MAXIMO) total = PARALELO_MAXIMO;
+    if (total <= 0) return;
+    for (int i = 0; i < total - 1; i++) {
+        iniciadas[i] = threadIniciar(&threads[i], rotinas[i], argumentos[i]);
+        if (!iniciadas[i]) rotinas[i](argumentos[i]);
+    }
+    rotinas[total - 1](argumentos[total - 1]);
+    for (int i = 0; i < total - 1; i++) {
+        if (iniciadas[i]) threadAguardar(threads[i]);
     }
+}
 
-    *dados = malloc(*total * tamanhoElemento);
-    if (*dados == NULL) {
-        printf("ERRO CRITICO: Falha ao alocar memoria para carregar '%s'!\n", nomeArquivo);
+
+// --- Paginas e Pool de Buffers ---
+
+// Os registros das tabelas ficam em paginas de tamanho fixo. Apenas um numero
+// limitado de paginas fica na memoria ao mesmo tempo (o pool, com substituicao
+// LRU); as demais continuam no .dat de origem ou, se ja foram alteradas, em um
+// arquivo temporario de troca. Assim a memoria usada pelos registros nao
+// depende do tamanho das tabelas. O numero de paginas do pool pode ser
+// ajustado pela variavel de ambiente OFICINA_CACHE_PAGINAS.
+//
+// O pool e compartilhado pelas tabelas e protegido por uma trava, ja que a
+// abertura le as tres tabelas em threads separadas.
+#define PAGINA_BYTES 16384
+#define POOL_PAGINAS_PADRAO 1024
+#define POOL_PAGINAS_MINIMO 4
+
+struct Vetor;
+
+typedef struct {
+    const struct Vetor* dono;
+    int pagina;
+    int sujo;
+    int anterior;
+    int proximo;
+} Quadro;
+
+typedef struct {
+    Quadro* quadros;
+    char* memoria;
+    int totalQuadros;
+    int maisRecente;
+    int menosRecente;
+    FILE* troca;
+    long tamanhoTroca;
+    Trava trava;
+} PoolPaginas;
+
+typedef struct {
+    int quadro;
+    long troca;
+} Pagina;
+
+void poolIniciar(PoolPaginas* pool) {
+    int quadros = POOL_PAGINAS_PADRAO;
+    const char* configurado = getenv("OFICINA_CACHE_PAGINAS");
+    if (configurado != NULL && atoi(configurado) > 0) quadros = atoi(configurado);
+    if (quadros < POOL_PAGINAS_MINIMO) quadros = POOL_PAGINAS_MINIMO;
+
+    pool->quadros = malloc(quadros * sizeof(Quadro));
+    pool->memoria = malloc((size_t)quadros * PAGINA_BYTES);
+    if (pool->quadros == NULL || pool->memoria == NULL) {
+        printf("ERRO CRITICO: Falha ao alocar memoria para o pool de paginas!\n");
         exit(EXIT_FAILURE);
     }
-    
-    if (fread(*dados, tamanhoElemento, *total, arquivo) != (size_t)*total) {
-        printf("ERRO CRITICO: Falha ao ler dados de '%s'.\n", nomeArquivo);
-        free(*dados);
-        *dados = NULL;
-        *total = 0;
-        pausarSistema();
+    for (int i = 0; i < quadros; i++) {
+        pool->quadros[i].dono = NULL;
+        pool->quadros[i].pagina = -1;
+        pool->quadros[i].sujo = 0;
+        pool->quadros[i].anterior = i - 1;
+        pool->quadros[i].proximo = i + 1 < quadros ? i + 1 : -1;
     }
-    
-    fclose(arquivo);
+    pool->totalQuadros = quadros;
+    pool->maisRecente = 0;
+    pool->menosRecente = quadros - 1;
+    pool->troca = NULL;
+    pool->tamanhoTroca = 0;
+    travaIniciar(&pool->trava);
 }
 
-void salvarClientes(Cliente* clientes, int total) {
-    FILE* arquivo = fopen("clientes.dat", "wb");
-    if (arquivo == NULL) {
-        perror("Erro ao salvar arquivo de clientes");
-        pausarSistema(); return;
+void poolLiberar(PoolPaginas* pool) {
+    free(pool->quadros);
+    free(pool->memoria);
+    if (pool->troca != NULL) fclose(pool->troca);
+    travaDestruir(&pool->trava);
+    pool->quadros = NULL;
+    pool->memoria = NULL;
+    pool->troca = NULL;
+}
+
+static char* poolMemoria(const PoolPaginas* pool, int quadro) {
+    return pool->memoria + (size_t)quadro * PAGINA_BYTES;
+}
+
+static void poolTornarRecente(PoolPaginas* pool, int indice) {
+    if (pool->maisRecente == indice) return;
+    Quadro* quadro = &pool->quadros[indice];
+    pool->quadros[quadro->anterior].proximo = quadro->proximo;
+    if (quadro->proximo != -1) pool->quadros[quadro->proximo].anterior = quadro->anterior;
+    else pool->menosRecente = quadro->anterior;
+    quadro->anterior = -1;
+    quadro->proximo = pool->maisRecente;
+    pool->quadros[pool->maisRecente].anterior = indice;
+    pool->maisRecente = indice;
+}
+
+// --- Formato dos Arquivos ---
+
+// Formato 2 dos .dat, independente de compilador e plataforma: inteiros em
+// little-endian gravados byte a byte, textos com o tamanho em varint (LEB128)
+// seguido apenas dos caracteres usados, e os registros agrupados em blocos
+// com CRC proprio.
+//
+//   cabecalho (28 bytes): "OFDB", versao (16 bits), tabela (16 bits),
+//                         registros, proximo ID de ordem (0 nas demais
+//                         tabelas), registros por bloco, blocos, CRC dos
+//                         24 bytes anteriores
+//   cada bloco:           registros, bytes de dados, CRC (dos 8 bytes
+//                         anteriores e dos dados), dados
+//
+// Arquivos sem a assinatura sao do formato 1 (um int com a contagem seguido
+// das structs gravadas com fwrite) e sao convertidos no primeiro checkpoint.
+#define FORMATO_MAGICA "OFDB"
+#define FORMATO_VERSAO 2
+#define FORMATO_CABECALHO_BYTES 28
+#define FORMATO_BLOCO_CABECALHO_BYTES 12
+#define REGISTRO_CODIFICADO_MAXIMO 512
+
+typedef enum {
+    TABELA_CLIENTES = 1,
+    TABELA_VEICULOS,
+    TABELA_ORDENS
+} TipoTabela;
+
+static void escreverU32(unsigned char* destino, unsigned int valor) {
+    for (int i = 0; i < 4; i++) destino[i] = (unsigned char)(valor >> (8 * i));
+}
+
+static unsigned int lerU32(const unsigned char* origem) {
+    return (unsigned int)origem[0] | (unsigned int)origem[1] << 8 | (unsigned int)origem[2] << 16 | (unsigned int)origem[3] << 24;
+}
+
+static unsigned char* escreverVarint(unsigned char* destino, unsigned int valor) {
+    while (valor >= 0x80) {
+        *destino++ = (unsigned char)(valor | 0x80);
+        valor >>= 7;
     }
-    fwrite(&total, sizeof(int), 1, arquivo);
-    fwrite(clientes, sizeof(Cliente), total, arquivo);
-    fclose(arquivo);
+    *destino++ = (unsigned char)valor;
+    return destino;
 }
 
-void salvarVeiculos(Veiculo* veiculos, int total) {
-    FILE* arquivo = fopen("veiculos.dat", "wb");
-    if (arquivo == NULL) {
-        perror("Erro ao salvar arquivo de veiculos");
-        pausarSistema(); return;
+static int lerVarint(const unsigned char** origem, const unsigned char* fim, unsigned int* valor) {
+    const unsigned char* p = *origem;
+    unsigned int resultado = 0;
+    for (int deslocamento = 0; deslocamento < 35; deslocamento += 7) {
+        if (p == fim) return 0;
+        resultado |= (unsigned int)(*p & 0x7F) << deslocamento;
+        if ((*p++ & 0x80) == 0) {
+            *origem = p;
+            *valor = resultado;
+            return 1;
+        }
     }
-    fwrite(&total, sizeof(int), 1, arquivo);
-    fwrite(veiculos, sizeof(Veiculo), total, arquivo);
-    fclose(arquivo);
+    return 0;
 }
 
-void salvarOrdens(OrdemServico* ordens, int total) {
-    FILE* arquivo = fopen("ordens.dat", "wb");
-    if (arquivo == NULL) {
-        perror("Erro ao salvar arquivo de ordens");
-        pausarSistema(); return;
+static unsigned char* escreverTexto(unsigned char* destino, const char* texto, size_t capacidade) {
+    size_t tamanho = strnlen(texto, capacidade - 1);
+    destino = escreverVarint(destino, (unsigned int)tamanho);
+    memcpy(destino, texto, tamanho);
+    return destino + tamanho;
+}
+
+// Textos maiores que o campo sao rejeitados, nunca truncados em silencio.
+static int lerTexto(const unsigned char** origem, const unsigned char* fim, char* destino, size_t capacidade) {
+    unsigned int tamanho;
+    if (!lerVarint(origem, fim, &tamanho) || tamanho >= capacidade || tamanho > (size_t)(fim - *origem)) return 0;
+    memcpy(destino, *origem, tamanho);
+    destino[tamanho] = '\0';
+    *origem += tamanho;
+    return 1;
+}
+
+// Retorna o numero de bytes gravados em 'destino' (no maximo REGISTRO_CODIFICADO_MAXIMO).
+size_t codificarRegistro(TipoTabela tabela, const void* registro, unsigned char* destino) {
+    unsigned char* p = destino;
+    if (tabela == TABELA_CLIENTES) {
+        const Cliente* cliente = registro;
+        p = escreverTexto(p, cliente->nome, sizeof(cliente->nome));
+        p = escreverTexto(p, cliente->cpf, sizeof(cliente->cpf));
+        p = escreverTexto(p, cliente->telefone, sizeof(cliente->telefone));
+    } else if (tabela == TABELA_VEICULOS) {
+        const Veiculo* veiculo = registro;
+        p = escreverTexto(p, veiculo->placa, sizeof(veiculo->placa));
+        p = escreverTexto(p, veiculo->modelo, sizeof(veiculo->modelo));
+        p = escreverVarint(p, (unsigned int)veiculo->ano);
+        p = escreverTexto(p, veiculo->cpf_cliente, sizeof(veiculo->cpf_cliente));
+    } else {
+        const OrdemServico* ordem = registro;
+        p = escreverVarint(p, (unsigned int)ordem->id);
+        p = escreverTexto(p, ordem->placa_veiculo, sizeof(ordem->placa_veiculo));
+        p = escreverTexto(p, ordem->data_entrada, sizeof(ordem->data_entrada));
+        p = escreverTexto(p, ordem->descricao_problema, sizeof(ordem->descricao_problema));
+        p = escreverVarint(p, (unsigned int)ordem->status);
+    }
+    return (size_t)(p - destino);
+}
+
+// Retorna 0 se os bytes nao formarem um registro valido.
+int decodificarRegistro(TipoTabela tabela, const unsigned char** origem, const unsigned char* fim, void* registro) {
+    unsigned int numero;
+    if (tabela == TABELA_CLIENTES) {
+        Cliente* cliente = registro;
+        memset(cliente, 0, sizeof(Cliente));
+        return lerTexto(origem, fim, cliente->nome, sizeof(cliente->nome)) &&
+               lerTexto(origem, fim, cliente->cpf, sizeof(cliente->cpf)) &&
+               lerTexto(origem, fim, cliente->telefone, sizeof(cliente->telefone));
+    } else if (tabela == TABELA_VEICULOS) {
+        Veiculo* veiculo = registro;
+        memset(veiculo, 0, sizeof(Veiculo));
+        if (!lerTexto(origem, fim, veiculo->placa, sizeof(veiculo->placa)) ||
+            !lerTexto(origem, fim, veiculo->modelo, sizeof(veiculo->modelo)) ||
+            !lerVarint(origem, fim, &numero)) return 0;
+        veiculo->ano = (int)numero;
+        return lerTexto(origem, fim, veiculo->cpf_cliente, sizeof(veiculo->cpf_cliente));
+    } else {
+        OrdemServico* ordem = registro;
+        memset(ordem, 0, sizeof(OrdemServico));
+        if (!lerVarint(origem, fim, &numero)) return 0;
+        ordem->id = (int)numero;
+        if (!lerTexto(origem, fim, ordem->placa_veiculo, sizeof(ordem->placa_veiculo)) ||
+            !lerTexto(origem, fim, ordem->data_entrada, sizeof(ordem->data_entrada)) ||
+            !lerTexto(origem, fim, ordem->descricao_problema, sizeof(ordem->descricao_problema)) ||
+            !lerVarint(origem, fim, &numero) || numero > ENTREGUE) return 0;
+        ordem->status = (StatusOrdem)numero;
+        return 1;
     }
-    fwrite(&total, sizeof(int), 1, arquivo);
-    fwrite(ordens, sizeof(OrdemServico), total, arquivo);
-    fclose(arquivo);
 }
 
 
-// --- Funcoes de logica e busca ---
+// --- Vetor Dinamico ---
 
-int buscarClientePorCPF(Cliente* clientes, int total, const char* cpf) {
-    for (int i = 0; i < total; i++) {
-        if (strcmp(clientes[i].cpf, cpf) == 0) return i;
+// Vetor generico de registros de tamanho fixo, guardados em paginas do pool.
+// A tabela de paginas e o vetor 'ativos' dobram de capacidade quando acaba o
+// espaco, entao anexar custa O(1) amortizado. Como uma pagina pode sair da
+// memoria a qualquer momento, os registros sao acessados por copia
+// (vetorLer / vetorGravar), nunca por ponteiro.
+//
+// Remover apenas marca a posicao como livre (lapide) e a empilha em uma lista
+// de posicoes livres, reaproveitada pelas proximas insercoes. 'total' e o
+// numero de posicoes em uso (vivas ou nao) e 'vivos' o numero de registros
+// validos; os arquivos so recebem os registros vivos, entao a compactacao
+// acontece ao salvar.
+//
+// Quando 'origem' nao e NULL, as primeiras 'totalOrigem' posicoes vem do .dat
+// carregado na memoria (ver vetorAbrirOrigem) e sao copiadas para o pool sob
+// demanda: no formato 1, direto; no formato 2, decodificando os blocos.
+typedef struct Vetor {
+    PoolPaginas* pool;
+    Pagina* paginas;
+    int totalPaginas;
+    int porPagina;
+    unsigned char* ativos;
+    int total;
+    int vivos;
+    int capacidade;
+    size_t tamanhoElemento;
+    int* livres;
+    int totalLivres;
+    int capacidadeLivres;
+    TipoTabela tabela;
+    const unsigned char* origem;
+    size_t tamanhoOrigem;
+    int origemMapeada;
+    int formatoOrigem;
+    int totalOrigem;
+    size_t* blocos;     // formato 2: inicio de cada bloco, 0 se corrompido
+    int porBloco;
+    int totalBlocos;
+} Vetor;
+
+void vetorIniciar(Vetor* vetor, size_t tamanhoElemento, TipoTabela tabela, PoolPaginas* pool) {
+    vetor->pool = pool;
+    vetor->paginas = NULL;
+    vetor->totalPaginas = 0;
+    vetor->porPagina = (int)(PAGINA_BYTES / tamanhoElemento);
+    vetor->ativos = NULL;
+    vetor->total = 0;
+    vetor->vivos = 0;
+    vetor->capacidade = 0;
+    vetor->tamanhoElemento = tamanhoElemento;
+    vetor->livres = NULL;
+    vetor->totalLivres = 0;
+    vetor->capacidadeLivres = 0;
+    vetor->tabela = tabela;
+    vetor->origem = NULL;
+    vetor->tamanhoOrigem = 0;
+    vetor->origemMapeada = 0;
+    vetor->formatoOrigem = 0;
+    vetor->totalOrigem = 0;
+    vetor->blocos = NULL;
+    vetor->porBloco = 0;
+    vetor->totalBlocos = 0;
+}
+
+static void vetorFecharOrigem(Vetor* vetor) {
+    #ifndef _WIN32
+        if (vetor->origem != NULL && vetor->origemMapeada) munmap((void*)vetor->origem, vetor->tamanhoOrigem);
+    #endif
+    if (vetor->origem != NULL && !vetor->origemMapeada) free((void*)vetor->origem);
+    free(vetor->blocos);
+    vetor->origem = NULL;
+    vetor->blocos = NULL;
+    vetor->totalOrigem = 0;
+}
+
+void vetorLiberar(Vetor* vetor) {
+    for (int i = 0; i < vetor->pool->totalQuadros; i++) {
+        if (vetor->pool->quadros[i].dono != vetor) continue;
+        vetor->pool->quadros[i].dono = NULL;
+        vetor->pool->quadros[i].sujo = 0;
     }
-    return -1;
+    vetorFecharOrigem(vetor);
+    free(vetor->paginas);
+    free(vetor->ativos);
+    free(vetor->livres);
+    vetorIniciar(vetor, vetor->tamanhoElemento, vetor->tabela, vetor->pool);
 }
 
-int buscarVeiculoPorPlaca(Veiculo* veiculos, int total, const char* placa) {
-    for (int i = 0; i < total; i++) {
-        if (strcmp(veiculos[i].placa, placa) == 0) return i;
+int vetorReservar(Vetor* vetor, int capacidadeMinima) {
+    if (capacidadeMinima <= vetor->capacidade) return 1;
+    int novaCapacidade = vetor->capacidade > 0 ? vetor->capacidade : 16;
+    while (novaCapacidade < capacidadeMinima) novaCapacidade *= 2;
+    unsigned char* novosAtivos = realloc(vetor->ativos, (size_t)novaCapacidade);
+    if (novosAtivos == NULL) return 0;
+    vetor->ativos = novosAtivos;
+
+    int novoTotalPaginas = (novaCapacidade + vetor->porPagina - 1) / vetor->porPagina;
+    if (novoTotalPaginas > vetor->totalPaginas) {
+        Pagina* novasPaginas = realloc(vetor->paginas, novoTotalPaginas * sizeof(Pagina));
+        if (novasPaginas == NULL) return 0;
+        for (int i = vetor->totalPaginas; i < novoTotalPaginas; i++) {
+            novasPaginas[i].quadro = -1;
+            novasPaginas[i].troca = -1;
+        }
+        vetor->paginas = novasPaginas;
+        vetor->totalPaginas = novoTotalPaginas;
     }
-    return -1;
+    vetor->capacidade = novaCapacidade;
+    return 1;
 }
 
-// --- Funcoes de gerenciamento do Clientes ---
+// Libera o quadro menos usado do pool. Uma pagina alterada vai para o arquivo
+// de troca; se nem isso for possivel, encerra (o diario guarda as alteracoes).
+static int poolDespejar(PoolPaginas* pool) {
+    int indice = pool->menosRecente;
+    Quadro* quadro = &pool->quadros[indice];
+    if (quadro->dono == NULL) return indice;
 
-void cadastrarCliente(Cliente** clientes, int* totalClientes) {
-    limparTela();
-    printf("--- Cadastro de Cliente ---\n");
-    Cliente novoCliente;
-    int overflow; 
-    
-    do {
-        printf("Nome: ");
-        if (!lerString(novoCliente.nome, 101)) {
-            printf("ERRO: Nome muito longo. Maximo de 99 caracteres.\n");
-            overflow = 1;
-        } else {
-            overflow = 0;
+    Pagina* pagina = &quadro->dono->paginas[quadro->pagina];
+    if (quadro->sujo) {
+        if (pool->troca == NULL) pool->troca = tmpfile();
+        if (pagina->troca < 0) {
+            pagina->troca = pool->tamanhoTroca;
+            pool->tamanhoTroca += PAGINA_BYTES;
         }
-        if (!overflow && strlen(novoCliente.nome) == 0) {
-            printf("ERRO: Nome nao pode ser vazio.\n");
-        } else if (!overflow && !validarNome(novoCliente.nome)) {
-            printf("ERRO: Nome deve conter apenas letras e espacos.\n");
+        if (pool->troca == NULL || fseek(pool->troca, pagina->troca, SEEK_SET) != 0 ||
+            fwrite(poolMemoria(pool, indice), PAGINA_BYTES, 1, pool->troca) != 1) {
+            printf("ERRO CRITICO: Falha ao gravar pagina no arquivo de troca!\n");
+            exit(EXIT_FAILURE);
         }
-    } while (overflow || strlen(novoCliente.nome) == 0 || !validarNome(novoCliente.nome));
+    }
+    pagina->quadro = -1;
+    quadro->dono = NULL;
+    quadro->sujo = 0;
+    return indice;
+}
 
-    do {
-        printf("CPF (11 digitos, sem pontos): ");
-        if (!lerString(novoCliente.cpf, 13)) { 
-            printf("ERRO: CPF muito longo. Maximo de 11 caracteres.\n");
-            overflow = 1;
-        } else {
-            overflow = 0;
-        }
-        
-        if (!overflow && !validarCPF(novoCliente.cpf)) {
-            printf("ERRO: Formato de CPF invalido. Deve ter 11 digitos.\n");
-        } else if (!overflow && buscarClientePorCPF(*clientes, *totalClientes, novoCliente.cpf) != -1) {
-            printf("ERRO: CPF ja cadastrado.\n");
-            novoCliente.cpf[0] = '\0';
+// Decodifica 'quantidade' registros do .dat no formato 2 a partir da posicao
+// 'inicio'. O arquivo pode ter sido gravado com outro numero de registros por
+// bloco, entao uma pagina pode comecar no meio de um bloco e atravessar varios.
+// Registros de blocos corrompidos ficam zerados (e marcados como livres na carga).
+// Um bloco que nao decodifica ate o fim e tratado como corrompido a partir do
+// registro com defeito, sem deslocar os registros dos blocos seguintes.
+static void vetorDecodificarOrigem(const Vetor* vetor, int inicio, int quantidade, char* memoria) {
+    int bloco = inicio / vetor->porBloco;
+    int pular = inicio % vetor->porBloco;
+    int lidos = 0;
+    for (; lidos < quantidade && bloco < vetor->totalBlocos; bloco++, pular = 0) {
+        int noBloco = vetor->totalOrigem - bloco * vetor->porBloco;
+        if (noBloco > vetor->porBloco) noBloco = vetor->porBloco;
+        if (vetor->blocos[bloco] == 0) {
+            lidos += noBloco - pular;
+            continue;
         }
-    } while (overflow || !validarCPF(novoCliente.cpf));
-    
-    do {
-        printf("Telefone: ");
-        if (!lerString(novoCliente.telefone, 16)) {
-            printf("ERRO: Telefone muito longo. Maximo de 14 caracteres.\n");
-            overflow = 1;
-        } else {
-            overflow = 0;
+        const unsigned char* p = vetor->origem + vetor->blocos[bloco];
+        const unsigned char* fim = p + FORMATO_BLOCO_CABECALHO_BYTES + lerU32(p + 4);
+        p += FORMATO_BLOCO_CABECALHO_BYTES;
+        for (int r = 0; r < noBloco && lidos < quantidade; r++) {
+            char* destino = memoria + (size_t)lidos * vetor->tamanhoElemento;
+            if (!decodificarRegistro(vetor->tabela, &p, fim, destino)) {
+                int restantes = noBloco - (r > pular ? r : pular);
+                if (restantes > quantidade - lidos) restantes = quantidade - lidos;
+                memset(destino, 0, (size_t)restantes * vetor->tamanhoElemento);
+                lidos += restantes;
+                break;
+            }
+            if (r >= pular) lidos++;
         }
-    } while (overflow);
-
-    Cliente* temp = malloc((*totalClientes + 1) * sizeof(Cliente));
-    if (temp == NULL) {
-        printf("ERRO CRITICO: Falha ao alocar memoria!\n");
-        pausarSistema(); return;
     }
-    
-    for (int i = 0; i < *totalClientes; i++) temp[i] = (*clientes)[i];
-    temp[*totalClientes] = novoCliente;
-    if (*clientes != NULL) free(*clientes);
-    *clientes = temp;
-    (*totalClientes)++;
+}
 
-    printf("\nCliente cadastrado com sucesso!\n");
-    pausarSistema();
+// Copia a pagina 'numero' do .dat de origem para 'memoria'.
+static void vetorCopiarOrigem(const Vetor* vetor, int numero, char* memoria) {
+    int inicio = numero * vetor->porPagina;
+    int quantidade = vetor->totalOrigem - inicio;
+    if (quantidade > vetor->porPagina) quantidade = vetor->porPagina;
+    if (vetor->formatoOrigem == 1) {
+        memcpy(memoria, vetor->origem + sizeof(int) + (size_t)inicio * vetor->tamanhoElemento, (size_t)quantidade * vetor->tamanhoElemento);
+    } else {
+        memset(memoria, 0, PAGINA_BYTES);
+        vetorDecodificarOrigem(vetor, inicio, quantidade, memoria);
+    }
 }
 
-void atualizarCliente(Cliente* clientes, int totalClientes) {
-    limparTela();
-    printf("--- Atualizacao de Cliente ---\n");
-    if (totalClientes == 0) {
-        printf("Nenhum cliente cadastrado.\n");
-        pausarSistema(); return;
+// Devolve a pagina na memoria, trazendo-a da troca ou do .dat se preciso.
+// Deve ser chamada com o pool travado; o ponteiro so vale enquanto a trava
+// estiver obtida. A copia do .dat (a decodificacao, no formato 2, e a parte
+// cara) e feita com a trava liberada, para que varias threads tragam paginas
+// ao mesmo tempo; se outra thread trouxer a mesma pagina nesse meio tempo, a
+// copia e descartada.
+static char* vetorPagina(const Vetor* vetor, int numero, int escrita) {
+    PoolPaginas* pool = vetor->pool;
+    Pagina* pagina = &vetor->paginas[numero];
+    char copia[PAGINA_BYTES];
+    int copiada = 0;
+    if (pagina->quadro < 0 && pagina->troca < 0 && numero * vetor->porPagina < vetor->totalOrigem) {
+        travaLiberar(&pool->trava);
+        vetorCopiarOrigem(vetor, numero, copia);
+        travaObter(&pool->trava);
+        copiada = 1;
     }
-    char cpf[12];
-    int overflow;
-    do {
-        printf("Digite o CPF do cliente a ser atualizado: ");
-        if (!lerString(cpf, 13)) {
-             printf("ERRO: Formato de CPF invalido. Maximo de 11 caracteres.\n");
-             overflow = 1;
+    int indice = pagina->quadro;
+    if (indice < 0) {
+        indice = poolDespejar(pool);
+        char* memoria = poolMemoria(pool, indice);
+        if (pagina->troca >= 0) {
+            if (fseek(pool->troca, pagina->troca, SEEK_SET) != 0 ||
+                fread(memoria, PAGINA_BYTES, 1, pool->troca) != 1) {
+                printf("ERRO CRITICO: Falha ao ler pagina do arquivo de troca!\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (copiada) {
+            memcpy(memoria, copia, PAGINA_BYTES);
         } else {
-            overflow = 0;
+            memset(memoria, 0, PAGINA_BYTES);
         }
-    } while (overflow);
-
-    int index = buscarClientePorCPF(clientes, totalClientes, cpf);
-    if (index == -1) {
-        printf("Cliente nao encontrado.\n");
-        pausarSistema(); return;
+        pool->quadros[indice].dono = vetor;
+        pool->quadros[indice].pagina = numero;
+        pagina->quadro = indice;
     }
+    poolTornarRecente(pool, indice);
+    if (escrita) pool->quadros[indice].sujo = 1;
+    return poolMemoria(pool, indice);
+}
 
-    printf("Digite os novos dados (deixe em branco para manter o atual):\n");
-    char buffer[100];
+void vetorLer(const Vetor* vetor, int indice, void* destino) {
+    travaObter(&vetor->pool->trava);
+    const char* pagina = vetorPagina(vetor, indice / vetor->porPagina, 0);
+    memcpy(destino, pagina + (size_t)(indice % vetor->porPagina) * vetor->tamanhoElemento, vetor->tamanhoElemento);
+    travaLiberar(&vetor->pool->trava);
+}
 
-    do {
-        printf("Nome atual: %s\nNovo nome: ", clientes[index].nome);
-        if (!lerString(buffer, 101)) {
-            printf("ERRO: Nome muito longo. Maximo de 99 caracteres.\n");
-            overflow = 1;
-        } else {
-            overflow = 0;
-            if (strlen(buffer) > 0) { 
-                if (!validarNome(buffer)) {
-                    printf("ERRO: Nome deve conter apenas letras e espacos.\n");
-                    overflow = 1; 
-                } else {
-                    strcpy(clientes[index].nome, buffer);
-                }
-            }
-        }
-    } while (overflow);
+void vetorGravar(Vetor* vetor, int indice, const void* elemento) {
+    travaObter(&vetor->pool->trava);
+    char* pagina = vetorPagina(vetor, indice / vetor->porPagina, 1);
+    memcpy(pagina + (size_t)(indice % vetor->porPagina) * vetor->tamanhoElemento, elemento, vetor->tamanhoElemento);
+    travaLiberar(&vetor->pool->trava);
+}
 
-    do {
-        printf("Telefone atual: %s\nNovo telefone: ", clientes[index].telefone);
-        if (!lerString(buffer, 16)) {
-            printf("ERRO: Telefone muito longo. Maximo de 14 caracteres.\n");
+int vetorAtivo(const Vetor* vetor, int indice) {
+    return vetor->ativos[indice];
+}
+
+// Retorna a posicao do novo elemento, ou -1 se faltar memoria.
+int vetorInserir(Vetor* vetor, const void* elemento) {
+    int posicao;
+    if (vetor->totalLivres > 0) {
+        posicao = vetor->livres[--vetor->totalLivres];
+    } else {
+        if (!vetorReservar(vetor, vetor->total + 1)) return -1;
+        posicao = vetor->total++;
+    }
+    vetorGravar(vetor, posicao, elemento);
+    vetor->ativos[posicao] = 1;
+    vetor->vivos++;
+    return posicao;
+}
+
+// Retorna 0 se faltar memoria para registrar a posicao livre.
+int vetorRemover(Vetor* vetor, int indice) {
+    if (vetor->totalLivres == vetor->capacidadeLivres) {
+        int novaCapacidade = vetor->capacidadeLivres > 0 ? vetor->capacidadeLivres * 2 : 16;
+        int* novos = realloc(vetor->livres, novaCapacidade * sizeof(int));
+        if (novos == NULL) return 0;
+        vetor->livres = novos;
+        vetor->capacidadeLivres = novaCapacidade;
+    }
+    vetor->ativos[indice] = 0;
+    vetor->livres[vetor->totalLivres++] = indice;
+    vetor->vivos--;
+    return 1;
+}
+
+// Deixa o .dat inteiro acessivel na memoria, de preferencia mapeado somente
+// para leitura: as paginas do arquivo so sao lidas do disco quando o pool
+// precisa delas, e o arquivo nunca e escrito por aqui -- a durabilidade
+// continua com o diario e o checkpoint, que substitui o .dat por rename sem
+// invalidar o mapeamento atual. Sem mmap, o arquivo (compacto no formato 2) e
+// lido de uma vez. Retorna 0 se faltar memoria.
+int vetorAbrirOrigem(Vetor* vetor, FILE* arquivo, size_t tamanho) {
+    #ifndef _WIN32
+        void* mapa = mmap(NULL, tamanho, PROT_READ, MAP_PRIVATE, fileno(arquivo), 0);
+        if (mapa != MAP_FAILED) {
+            vetor->origem = mapa;
+            vetor->tamanhoOrigem = tamanho;
+            vetor->origemMapeada = 1;
+            return 1;
+        }
+    #endif
+    unsigned char* dados = malloc(tamanho);
+    if (dados == NULL) return 0;
+    if (fseek(arquivo, 0, SEEK_SET) != 0 || fread(dados, 1, tamanho, arquivo) != tamanho) {
+        free(dados);
+        return 0;
+    }
+    vetor->origem = dados;
+    vetor->tamanhoOrigem = tamanho;
+    vetor->origemMapeada = 0;
+    return 1;
+}
+
+static void gravarBloco(FILE* arquivo, unsigned char* bloco, int registros, size_t usados) {
+    escreverU32(bloco, (unsigned int)registros);
+    escreverU32(bloco + 4, (unsigned int)(usados - FORMATO_BLOCO_CABECALHO_BYTES));
+    unsigned int crc = calcularCRC32(0, bloco, 8);
+    escreverU32(bloco + 8, calcularCRC32(crc, bloco + FORMATO_BLOCO_CABECALHO_BYTES, usados - FORMATO_BLOCO_CABECALHO_BYTES));
+    fwrite(bloco, 1, usados, arquivo);
+}
+
+// Grava somente os registros vivos, no formato 2. 'proximoId' vai para o
+// cabecalho (0 nas tabelas sem ID). Retorna 0 se faltar memoria.
+int vetorGravarVivos(const Vetor* vetor, FILE* arquivo, int proximoId) {
+    int porBloco = vetor->porPagina;
+    int totalBlocos = (vetor->vivos + porBloco - 1) / porBloco;
+    unsigned char* bloco = malloc((size_t)porBloco * REGISTRO_CODIFICADO_MAXIMO + FORMATO_BLOCO_CABECALHO_BYTES);
+    if (bloco == NULL) return 0;
+
+    unsigned char cabecalho[FORMATO_CABECALHO_BYTES];
+    memcpy(cabecalho, FORMATO_MAGICA, 4);
+    cabecalho[4] = FORMATO_VERSAO;
+    cabecalho[5] = 0;
+    cabecalho[6] = (unsigned char)vetor->tabela;
+    cabecalho[7] = 0;
+    escreverU32(cabecalho + 8, (unsigned int)vetor->vivos);
+    escreverU32(cabecalho + 12, (unsigned int)proximoId);
+    escreverU32(cabecalho + 16, (unsigned int)porBloco);
+    escreverU32(cabecalho + 20, (unsigned int)totalBlocos);
+    escreverU32(cabecalho + 24, calcularCRC32(0, cabecalho, 24));
+    fwrite(cabecalho, sizeof(cabecalho), 1, arquivo);
+
+    union {
+        Cliente cliente;
+        Veiculo veiculo;
+        OrdemServico ordem;
+    } registro;
+    int noBloco = 0;
+    size_t usados = FORMATO_BLOCO_CABECALHO_BYTES;
+    for (int i = 0; i < vetor->total; i++) {
+        if (!vetor->ativos[i]) continue;
+        vetorLer(vetor, i, &registro);
+        usados += codificarRegistro(vetor->tabela, &registro, bloco + usados);
+        if (++noBloco < porBloco) continue;
+        gravarBloco(arquivo, bloco, noBloco, usados);
+        noBloco = 0;
+        usados = FORMATO_BLOCO_CABECALHO_BYTES;
+    }
+    if (noBloco > 0) gravarBloco(arquivo, bloco, noBloco, usados);
+    free(bloco);
+    return 1;
+}
+
+
+// --- Funcoes de Banco de Dados (Arquivos) ---
+
+// Os tres arquivos sao carregados ao mesmo tempo (ver carregarOficina); a
+// trava impede que os avisos de tabelas diferentes se misturem na tela.
+static Trava travaAvisos;
+
+// Guarda uma copia do arquivo danificado em '<arquivo>.corrompido' antes que
+// o proximo checkpoint o substitua.
+static void preservarArquivoCorrompido(const char* nomeArquivo, const Vetor* vetor) {
+    char copia[128];
+    snprintf(copia, sizeof(copia), "%s.corrompido", nomeArquivo);
+    FILE* arquivo = fopen(copia, "wb");
+    if (arquivo == NULL) return;
+    fwrite(vetor->origem, 1, vetor->tamanhoOrigem, arquivo);
+    fclose(arquivo);
+    printf("Uma copia do arquivo original foi guardada em '%s'.\n", copia);
+}
+
+static void avisarArquivoCorrompido(const char* nomeArquivo, Vetor* vetor) {
+    travaObter(&travaAvisos);
+    printf("Aviso: Arquivo '%s' corrompido. Iniciando com base limpa.\n", nomeArquivo);
+    preservarArquivoCorrompido(nomeArquivo, vetor);
+    pausarSistema();
+    travaLiberar(&travaAvisos);
+    vetorFecharOrigem(vetor);
+}
+
+// Formato 1: o total so e aceito se o arquivo realmente contiver esses registros.
+static int carregarFormato1(const char* nomeArquivo, Vetor* vetor) {
+    int total;
+    memcpy(&total, vetor->origem, sizeof(int));
+    if (total < 0 || vetor->tamanhoOrigem < sizeof(int) + (size_t)total * vetor->tamanhoElemento) {
+        avisarArquivoCorrompido(nomeArquivo, vetor);
+        return 0;
+    }
+    if (!vetorReservar(vetor, total)) {
+        printf("ERRO CRITICO: Falha ao alocar memoria para carregar '%s'!\n", nomeArquivo);
+        exit(EXIT_FAILURE);
+    }
+    if (total > 0) memset(vetor->ativos, 1, (size_t)total);
+    vetor->formatoOrigem = 1;
+    vetor->totalOrigem = total;
+    vetor->total = total;
+    vetor->vivos = total;
+    return 1;
+}
+
+// Formato 2: confere o cabecalho, o CRC de cada bloco e se cada bloco decodifica
+// por inteiro. Os registros de um bloco corrompido sao descartados (viram
+// posicoes livres); se o tamanho de um bloco estiver danificado, os seguintes
+// nao podem ser localizados e tambem sao descartados.
+static int carregarFormato2(const char* nomeArquivo, Vetor* vetor, int* proximoId) {
+    const unsigned char* dados = vetor->origem;
+    size_t tamanho = vetor->tamanhoOrigem;
+    if (tamanho < FORMATO_CABECALHO_BYTES || lerU32(dados + 24) != calcularCRC32(0, dados, 24)) {
+        avisarArquivoCorrompido(nomeArquivo, vetor);
+        return 0;
+    }
+    int versao = dados[4] | dados[5] << 8;
+    if (versao > FORMATO_VERSAO) {
+        printf("ERRO CRITICO: '%s' foi gravado por uma versao mais nova do programa (formato %d).\n", nomeArquivo, versao);
+        exit(EXIT_FAILURE);
+    }
+    // Com a assinatura do formato, versoes abaixo de 2 nunca foram gravadas.
+    if (versao < 2) {
+        avisarArquivoCorrompido(nomeArquivo, vetor);
+        return 0;
+    }
+    unsigned int registros = lerU32(dados + 8);
+    unsigned int porBloco = lerU32(dados + 16);
+    unsigned int totalBlocos = lerU32(dados + 20);
+    // Cada registro ocupa ao menos 3 bytes, o que limita o total pelo tamanho do arquivo.
+    if ((dados[6] | dados[7] << 8) != (int)vetor->tabela || porBloco == 0 || registros > tamanho / 3 ||
+        totalBlocos != (registros + porBloco - 1) / porBloco) {
+        avisarArquivoCorrompido(nomeArquivo, vetor);
+        return 0;
+    }
+    if (proximoId != NULL) *proximoId = (int)lerU32(dados + 12);
+
+    vetor->blocos = malloc((totalBlocos > 0 ? totalBlocos : 1) * sizeof(size_t));
+    if (vetor->blocos == NULL || !vetorReservar(vetor, (int)registros)) {
+        printf("ERRO CRITICO: Falha ao alocar memoria para carregar '%s'!\n", nomeArquivo);
+        exit(EXIT_FAILURE);
+    }
+    vetor->formatoOrigem = 2;
+    vetor->porBloco = (int)porBloco;
+    vetor->totalBlocos = (int)totalBlocos;
+    vetor->totalOrigem = (int)registros;
+    vetor->total = (int)registros;
+    vetor->vivos = (int)registros;
+    if (registros > 0) memset(vetor->ativos, 1, registros);
+
+    size_t deslocamento = FORMATO_CABECALHO_BYTES;
+    int localizavel = 1;
+    int descartados = 0;
+    union {
+        Cliente cliente;
+        Veiculo veiculo;
+        OrdemServico ordem;
+    } registro;
+    for (unsigned int b = 0; b < totalBlocos; b++) {
+        unsigned int esperados = registros - b * porBloco < porBloco ? registros - b * porBloco : porBloco;
+        int integro = 0;
+        if (localizavel && tamanho - deslocamento >= FORMATO_BLOCO_CABECALHO_BYTES) {
+            const unsigned char* bloco = dados + deslocamento;
+            unsigned int bytes = lerU32(bloco + 4);
+            if (lerU32(bloco) != esperados || bytes > tamanho - deslocamento - FORMATO_BLOCO_CABECALHO_BYTES) {
+                localizavel = 0;
+            } else {
+                unsigned int crc = calcularCRC32(0, bloco, 8);
+                integro = calcularCRC32(crc, bloco + FORMATO_BLOCO_CABECALHO_BYTES, bytes) == lerU32(bloco + 8);
+                // O CRC so garante que os bytes sao os gravados; um bloco gravado
+                // com defeito ainda pode nao decodificar.
+                const unsigned char* p = bloco + FORMATO_BLOCO_CABECALHO_BYTES;
+                const unsigned char* fim = p + bytes;
+                for (unsigned int r = 0; integro && r < esperados; r++) {
+                    integro = decodificarRegistro(vetor->tabela, &p, fim, &registro);
+                }
+                vetor->blocos[b] = integro ? deslocamento : 0;
+                deslocamento += FORMATO_BLOCO_CABECALHO_BYTES + bytes;
+            }
+        } else {
+            localizavel = 0;
+        }
+        if (integro) continue;
+        vetor->blocos[b] = 0;
+        for (unsigned int r = 0; r < esperados; r++) {
+            if (!vetorRemover(vetor, (int)(b * porBloco + r))) {
+                printf("ERRO CRITICO: Falha ao alocar memoria para carregar '%s'!\n", nomeArquivo);
+                exit(EXIT_FAILURE);
+            }
+        }
+        descartados += (int)esperados;
+    }
+    if (descartados > 0) {
+        travaObter(&travaAvisos);
+        printf("Aviso: %d registro(s) de '%s' estavam em blocos corrompidos e foram descartados.\n", descartados, nomeArquivo);
+        preservarArquivoCorrompido(nomeArquivo, vetor);
+        pausarSistema();
+        travaLiberar(&travaAvisos);
+    }
+    return 2;
+}
+
+// Retorna o formato do arquivo carregado (1 ou 2), ou 0 se nao havia dados.
+// 'proximoId', se nao for NULL, recebe o proximo ID de ordem gravado (formato 2).
+int carregarDados(const char* nomeArquivo, Vetor* vetor, int* proximoId) {
+    FILE* arquivo = fopen(nomeArquivo, "rb");
+    if (arquivo == NULL) return 0;
+
+    fseek(arquivo, 0, SEEK_END);
+    long tamanhoArquivo = ftell(arquivo);
+    if (tamanhoArquivo < (long)sizeof(int)) {
+        fclose(arquivo);
+        return 0;
+    }
+    if (!vetorAbrirOrigem(vetor, arquivo, (size_t)tamanhoArquivo)) {
+        printf("ERRO CRITICO: Falha ao alocar memoria para carregar '%s'!\n", nomeArquivo);
+        exit(EXIT_FAILURE);
+    }
+    fclose(arquivo);
+
+    if (memcmp(vetor->origem, FORMATO_MAGICA, 4) == 0) return carregarFormato2(nomeArquivo, vetor, proximoId);
+    return carregarFormato1(nomeArquivo, vetor);
+}
+
+// Grava em um arquivo temporario e so entao o renomeia por cima do original,
+// para que uma queda no meio da gravacao nunca deixe um .dat pela metade.
+int salvarTabela(const char* nomeArquivo, const Vetor* vetor, int proximoId) {
+    char temporario[64];
+    snprintf(temporario, sizeof(temporario), "%s.tmp", nomeArquivo);
+    FILE* arquivo = fopen(temporario, "wb");
+    if (arquivo == NULL) return 0;
+
+    int sucesso = vetorGravarVivos(vetor, arquivo, proximoId);
+    sucesso = sucesso && !ferror(arquivo) && sincronizarArquivo(arquivo);
+    if (fclose(arquivo) != 0) sucesso = 0;
+    if (!sucesso) {
+        remove(temporario);
+        return 0;
+    }
+    #ifdef _WIN32
+        remove(nomeArquivo);
+    #endif
+    return rename(temporario, nomeArquivo) == 0;
+}
+
+int salvarClientes(const Vetor* clientes) {
+    if (!salvarTabela("clientes.dat", clientes, 0)) {
+        exibirTela();
+        perror("Erro ao salvar arquivo de clientes");
+        pausarSistema(); return 0;
+    }
+    return 1;
+}
+
+int salvarVeiculos(const Vetor* veiculos) {
+    if (!salvarTabela("veiculos.dat", veiculos, 0)) {
+        exibirTela();
+        perror("Erro ao salvar arquivo de veiculos");
+        pausarSistema(); return 0;
+    }
+    return 1;
+}
+
+int salvarOrdens(const Vetor* ordens, int proximoId) {
+    if (!salvarTabela("ordens.dat", ordens, proximoId)) {
+        exibirTela();
+        perror("Erro ao salvar arquivo de ordens");
+        pausarSistema(); return 0;
+    }
+    return 1;
+}
+
+
+// --- Indices em Memoria ---
+
+// Tabela hash de enderecamento aberto (sondagem linear) que associa uma chave
+// numerica a posicao do registro no vetor correspondente.
+#define INDICE_VAZIO -1
+#define INDICE_REMOVIDO -2
+
+typedef struct {
+    unsigned long long chave;
+    int posicao;
+} EntradaIndice;
+
+typedef struct {
+    EntradaIndice* entradas;
+    int capacidade;
+    int ocupadas;
+    int total;
+} IndiceHash;
+
+static unsigned long long misturarChave(unsigned long long x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+void indiceLiberar(IndiceHash* indice) {
+    free(indice->entradas);
+    indice->entradas = NULL;
+    indice->capacidade = 0;
+    indice->ocupadas = 0;
+    indice->total = 0;
+}
+
+static void indiceRedimensionar(IndiceHash* indice, int novaCapacidade) {
+    EntradaIndice* novas = malloc(novaCapacidade * sizeof(EntradaIndice));
+    if (novas == NULL) {
+        printf("ERRO CRITICO: Falha ao alocar memoria para o indice!\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < novaCapacidade; i++) novas[i].posicao = INDICE_VAZIO;
+
+    for (int i = 0; i < indice->capacidade; i++) {
+        if (indice->entradas[i].posicao < 0) continue;
+        int j = (int)(misturarChave(indice->entradas[i].chave) & (unsigned long long)(novaCapacidade - 1));
+        while (novas[j].posicao != INDICE_VAZIO) j = (j + 1) & (novaCapacidade - 1);
+        novas[j] = indice->entradas[i];
+    }
+
+    free(indice->entradas);
+    indice->entradas = novas;
+    indice->capacidade = novaCapacidade;
+    indice->ocupadas = indice->total;
+}
+
+void indiceIniciar(IndiceHash* indice, int capacidadeInicial) {
+    int capacidade = 16;
+    while (capacidade < capacidadeInicial * 2) capacidade *= 2;
+    indice->entradas = NULL;
+    indice->capacidade = 0;
+    indice->ocupadas = 0;
+    indice->total = 0;
+    indiceRedimensionar(indice, capacidade);
+}
+
+int indiceBuscar(const IndiceHash* indice, unsigned long long chave) {
+    if (indice->capacidade == 0) return -1;
+    int mascara = indice->capacidade - 1;
+    int i = (int)(misturarChave(chave) & (unsigned long long)mascara);
+    while (indice->entradas[i].posicao != INDICE_VAZIO) {
+        if (indice->entradas[i].posicao >= 0 && indice->entradas[i].chave == chave) {
+            return indice->entradas[i].posicao;
+        }
+        i = (i + 1) & mascara;
+    }
+    return -1;
+}
+
+void indiceInserir(IndiceHash* indice, unsigned long long chave, int posicao) {
+    if ((indice->ocupadas + 1) * 4 >= indice->capacidade * 3) {
+        int novaCapacidade = indice->capacidade > 0 ? indice->capacidade : 16;
+        if ((indice->total + 1) * 2 >= indice->capacidade) novaCapacidade *= 2;
+        indiceRedimensionar(indice, novaCapacidade);
+    }
+
+    int mascara = indice->capacidade - 1;
+    int i = (int)(misturarChave(chave) & (unsigned long long)mascara);
+    int livre = -1;
+    while (indice->entradas[i].posicao != INDICE_VAZIO) {
+        if (indice->entradas[i].posicao >= 0 && indice->entradas[i].chave == chave) {
+            indice->entradas[i].posicao = posicao;
+            return;
+        }
+        if (livre == -1 && indice->entradas[i].posicao == INDICE_REMOVIDO) livre = i;
+        i = (i + 1) & mascara;
+    }
+
+    if (livre == -1) {
+        livre = i;
+        indice->ocupadas++;
+    }
+    indice->entradas[livre].chave = chave;
+    indice->entradas[livre].posicao = posicao;
+    indice->total++;
+}
+
+void indiceRemover(IndiceHash* indice, unsigned long long chave) {
+    if (indice->capacidade == 0) return;
+    int mascara = indice->capacidade - 1;
+    int i = (int)(misturarChave(chave) & (unsigned long long)mascara);
+    while (indice->entradas[i].posicao != INDICE_VAZIO) {
+        if (indice->entradas[i].posicao >= 0 && indice->entradas[i].chave == chave) {
+            indice->entradas[i].posicao = INDICE_REMOVIDO;
+            indice->total--;
+            return;
+        }
+        i = (i + 1) & mascara;
+    }
+}
+
+// O CPF validado (11 digitos) cabe em um inteiro de 64 bits.
+int chaveCPF(const char* cpf, unsigned long long* chave) {
+    if (!validarCPF(cpf)) return 0;
+    unsigned long long valor = 0;
+    for (int i = 0; i < 11; i++) valor = valor * 10 + (unsigned long long)(cpf[i] - '0');
+    *chave = valor;
+    return 1;
+}
+
+void construirIndiceCPF(IndiceHash* indice, const Vetor* clientes) {
+    indiceIniciar(indice, clientes->total);
+    unsigned long long chave;
+    for (int i = 0; i < clientes->total; i++) {
+        if (!vetorAtivo(clientes, i)) continue;
+        Cliente cliente;
+        vetorLer(clientes, i, &cliente);
+        if (chaveCPF(cliente.cpf, &chave)) indiceInserir(indice, chave, i);
+    }
+}
+
+// Chave de placa em 32 bits:
+//   bit 31     : formato (0 = AAA1234; 1 = Mercosul AAA1A23, reservado)
+//   bits 0..30 : ((L1 * 26 + L2) * 26 + L3) * 10000 + numero, sempre < 2^28
+// Letras sao comparadas sem diferenciar maiusculas de minusculas. O formato
+// Mercosul cabe no mesmo espaco: 26^3 * 10 * 26 * 100 < 2^31.
+#define PLACA_FORMATO_MERCOSUL 0x80000000u
+
+int chavePlaca(const char* placa, unsigned int* chave) {
+    if (!validarPlaca(placa)) return 0;
+    unsigned int valor = 0;
+    for (int i = 0; i < 3; i++) valor = valor * 26 + (unsigned int)(toupper((unsigned char)placa[i]) - 'A');
+    for (int i = 3; i < 7; i++) valor = valor * 10 + (unsigned int)(placa[i] - '0');
+    *chave = valor;
+    return 1;
+}
+
+void construirIndicePlaca(IndiceHash* indice, const Vetor* veiculos) {
+    indiceIniciar(indice, veiculos->total);
+    unsigned int chave;
+    for (int i = 0; i < veiculos->total; i++) {
+        if (!vetorAtivo(veiculos, i)) continue;
+        Veiculo veiculo;
+        vetorLer(veiculos, i, &veiculo);
+        if (chavePlaca(veiculo.placa, &chave)) indiceInserir(indice, chave, i);
+    }
+}
+
+// Colunas quentes das ordens: os campos usados em filtros e indices ficam em
+// vetores densos por posicao, fora das paginas de registros. Uma varredura
+// le 13 bytes por ordem em vez dos ~230 do registro inteiro (quase todos da
+// descricao), e os lacos sobre elas sao simples o bastante para o compilador
+// vetorizar. O registro completo so e lido para exibir ou gravar a ordem.
+#define SEM_PLACA 0xFFFFFFFFu
+
+typedef struct {
+    int* ids;               // 0 = posicao livre
+    unsigned int* placas;   // chavePlaca, ou SEM_PLACA
+    int* dias;              // data compacta (converterData), ou 0
+    unsigned char* status;
+    int total;
+    int capacidade;
+} ColunasOrdens;
+
+void colunasIniciar(ColunasOrdens* colunas) {
+    colunas->ids = NULL;
+    colunas->placas = NULL;
+    colunas->dias = NULL;
+    colunas->status = NULL;
+    colunas->total = 0;
+    colunas->capacidade = 0;
+}
+
+void colunasLiberar(ColunasOrdens* colunas) {
+    free(colunas->ids);
+    free(colunas->placas);
+    free(colunas->dias);
+    free(colunas->status);
+    colunasIniciar(colunas);
+}
+
+static void colunasReservar(ColunasOrdens* colunas, int quantidade) {
+    if (quantidade <= colunas->capacidade) return;
+    int novaCapacidade = colunas->capacidade > 0 ? colunas->capacidade : 64;
+    while (novaCapacidade < quantidade) novaCapacidade *= 2;
+    int* ids = realloc(colunas->ids, novaCapacidade * sizeof(int));
+    if (ids != NULL) colunas->ids = ids;
+    unsigned int* placas = realloc(colunas->placas, novaCapacidade * sizeof(unsigned int));
+    if (placas != NULL) colunas->placas = placas;
+    int* dias = realloc(colunas->dias, novaCapacidade * sizeof(int));
+    if (dias != NULL) colunas->dias = dias;
+    unsigned char* status = realloc(colunas->status, (size_t)novaCapacidade);
+    if (status != NULL) colunas->status = status;
+    if (ids == NULL || placas == NULL || dias == NULL || status == NULL) {
+        printf("ERRO CRITICO: Falha ao alocar memoria para as colunas de ordens!\n");
+        exit(EXIT_FAILURE);
+    }
+    colunas->capacidade = novaCapacidade;
+}
+
+void colunasDefinir(ColunasOrdens* colunas, int posicao, const OrdemServico* ordem) {
+    colunasReservar(colunas, posicao + 1);
+    while (colunas->total <= posicao) colunas->ids[colunas->total++] = 0;
+    colunas->ids[posicao] = ordem->id;
+    if (!chavePlaca(ordem->placa_veiculo, &colunas->placas[posicao])) colunas->placas[posicao] = SEM_PLACA;
+    if (!converterData(ordem->data_entrada, &colunas->dias[posicao])) colunas->dias[posicao] = 0;
+    colunas->status[posicao] = (unsigned char)ordem->status;
+}
+
+// Unica passada pelas paginas de ordens na carga; os demais indices de ordens
+// sao construidos a partir das colunas.
+void construirColunasOrdens(ColunasOrdens* colunas, const Vetor* ordens) {
+    colunasIniciar(colunas);
+    colunasReservar(colunas, ordens->total);
+    for (int i = 0; i < ordens->total; i++) {
+        if (!vetorAtivo(ordens, i)) {
+            colunas->ids[colunas->total++] = 0;
+            continue;
+        }
+        OrdemServico ordem;
+        vetorLer(ordens, i, &ordem);
+        colunasDefinir(colunas, i, &ordem);
+    }
+}
+
+// Os IDs de ordem sao densos (1, 2, 3...), entao o mapa id -> posicao e um
+// vetor direto. Como o proximo ID vem do maior ID conhecido e nao do total de
+// registros, o mapa continua valido se ordens forem compactadas ou arquivadas;
+// basta reconstrui-lo ou redefinir as posicoes movidas.
+typedef struct {
+    int* posicoes;
+    int capacidade;
+    int maiorId;
+} MapaIdOrdem;
+
+void mapaOrdensLiberar(MapaIdOrdem* mapa) {
+    free(mapa->posicoes);
+    mapa->posicoes = NULL;
+    mapa->capacidade = 0;
+    mapa->maiorId = 0;
+}
+
+void mapaOrdensDefinir(MapaIdOrdem* mapa, int id, int posicao) {
+    if (id <= 0) return;
+    if (id >= mapa->capacidade) {
+        int novaCapacidade = mapa->capacidade > 0 ? mapa->capacidade : 64;
+        while (novaCapacidade <= id) novaCapacidade *= 2;
+        int* novas = realloc(mapa->posicoes, novaCapacidade * sizeof(int));
+        if (novas == NULL) {
+            printf("ERRO CRITICO: Falha ao alocar memoria para o indice de ordens!\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = mapa->capacidade; i < novaCapacidade; i++) novas[i] = -1;
+        mapa->posicoes = novas;
+        mapa->capacidade = novaCapacidade;
+    }
+    mapa->posicoes[id] = posicao;
+    if (id > mapa->maiorId) mapa->maiorId = id;
+}
+
+int mapaOrdensBuscar(const MapaIdOrdem* mapa, int id) {
+    if (id <= 0 || id >= mapa->capacidade) return -1;
+    return mapa->posicoes[id];
+}
+
+int proximoIdOrdem(const MapaIdOrdem* mapa) {
+    return mapa->maiorId + 1;
+}
+
+void construirMapaOrdens(MapaIdOrdem* mapa, const ColunasOrdens* colunas) {
+    mapa->posicoes = NULL;
+    mapa->capacidade = 0;
+    mapa->maiorId = 0;
+    for (int i = 0; i < colunas->total; i++) {
+        if (colunas->ids[i] != 0) mapaOrdensDefinir(mapa, colunas->ids[i], i);
+    }
+}
+
+// Indice secundario de uma chave para varias posicoes: a IndiceHash aponta
+// para uma lista de posicoes por chave, na ordem em que foram adicionadas.
+typedef struct {
+    int* posicoes;
+    int total;
+    int capacidade;
+} ListaPosicoes;
+
+typedef struct {
+    IndiceHash chaves;
+    ListaPosicoes* listas;
+    int totalListas;
+    int capacidadeListas;
+} IndiceMultiplo;
+
+void multiIniciar(IndiceMultiplo* indice, int capacidadeInicial) {
+    indiceIniciar(&indice->chaves, capacidadeInicial);
+    indice->listas = NULL;
+    indice->totalListas = 0;
+    indice->capacidadeListas = 0;
+}
+
+void multiLiberar(IndiceMultiplo* indice) {
+    for (int i = 0; i < indice->totalListas; i++) free(indice->listas[i].posicoes);
+    free(indice->listas);
+    indice->listas = NULL;
+    indice->totalListas = 0;
+    indice->capacidadeListas = 0;
+    indiceLiberar(&indice->chaves);
+}
+
+const ListaPosicoes* multiBuscar(const IndiceMultiplo* indice, unsigned long long chave) {
+    int lista = indiceBuscar(&indice->chaves, chave);
+    if (lista == -1) return NULL;
+    return &indice->listas[lista];
+}
+
+int multiContar(const IndiceMultiplo* indice, unsigned long long chave) {
+    const ListaPosicoes* lista = multiBuscar(indice, chave);
+    return lista != NULL ? lista->total : 0;
+}
+
+void multiAdicionar(IndiceMultiplo* indice, unsigned long long chave, int posicao) {
+    int numeroLista = indiceBuscar(&indice->chaves, chave);
+    if (numeroLista == -1) {
+        if (indice->totalListas == indice->capacidadeListas) {
+            int novaCapacidade = indice->capacidadeListas > 0 ? indice->capacidadeListas * 2 : 16;
+            ListaPosicoes* novas = realloc(indice->listas, novaCapacidade * sizeof(ListaPosicoes));
+            if (novas == NULL) {
+                printf("ERRO CRITICO: Falha ao alocar memoria para o indice!\n");
+                exit(EXIT_FAILURE);
+            }
+            indice->listas = novas;
+            indice->capacidadeListas = novaCapacidade;
+        }
+        numeroLista = indice->totalListas++;
+        indice->listas[numeroLista].posicoes = NULL;
+        indice->listas[numeroLista].total = 0;
+        indice->listas[numeroLista].capacidade = 0;
+        indiceInserir(&indice->chaves, chave, numeroLista);
+    }
+
+    ListaPosicoes* lista = &indice->listas[numeroLista];
+    if (lista->total == lista->capacidade) {
+        int novaCapacidade = lista->capacidade > 0 ? lista->capacidade * 2 : 4;
+        int* novas = realloc(lista->posicoes, novaCapacidade * sizeof(int));
+        if (novas == NULL) {
+            printf("ERRO CRITICO: Falha ao alocar memoria para o indice!\n");
+            exit(EXIT_FAILURE);
+        }
+        lista->posicoes = novas;
+        lista->capacidade = novaCapacidade;
+    }
+    lista->posicoes[lista->total++] = posicao;
+}
+
+void multiRemover(IndiceMultiplo* indice, unsigned long long chave, int posicao) {
+    int numeroLista = indiceBuscar(&indice->chaves, chave);
+    if (numeroLista == -1) return;
+    ListaPosicoes* lista = &indice->listas[numeroLista];
+    for (int i = 0; i < lista->total; i++) {
+        if (lista->posicoes[i] == posicao) {
+            memmove(&lista->posicoes[i], &lista->posicoes[i + 1], (lista->total - i - 1) * sizeof(int));
+            lista->total--;
+            return;
+        }
+    }
+}
+
+void construirOrdensPorPlaca(IndiceMultiplo* indice, const ColunasOrdens* colunas) {
+    multiIniciar(indice, colunas->total);
+    for (int i = 0; i < colunas->total; i++) {
+        if (colunas->ids[i] != 0 && colunas->placas[i] != SEM_PLACA) multiAdicionar(indice, colunas->placas[i], i);
+    }
+}
+
+// Frota de cada cliente; o tamanho da lista e a contagem de referencias
+// usada para impedir a remocao de um cliente que ainda possui veiculos.
+void construirVeiculosPorCPF(IndiceMultiplo* indice, const Vetor* veiculos) {
+    multiIniciar(indice, veiculos->vivos);
+    unsigned long long chave;
+    for (int i = 0; i < veiculos->total; i++) {
+        if (!vetorAtivo(veiculos, i)) continue;
+        Veiculo veiculo;
+        vetorLer(veiculos, i, &veiculo);
+        if (chaveCPF(veiculo.cpf_cliente, &chave)) multiAdicionar(indice, chave, i);
+    }
+}
+
+// Ordens por data de entrada: cada dia distinto aponta para a lista das suas
+// ordens (IndiceMultiplo) e os dias ficam tambem num vetor ordenado, entao um
+// periodo e respondido com uma busca binaria e uma varredura so dos dias dentro
+// dele. Ordens com data invalida (gravadas antes da validacao) ficam de fora.
+typedef struct {
+    IndiceMultiplo porDia;
+    int* dias;
+    int totalDias;
+    int capacidadeDias;
+} IndiceDatas;
+
+void datasIniciar(IndiceDatas* indice, int capacidadeInicial) {
+    multiIniciar(&indice->porDia, capacidadeInicial);
+    indice->dias = NULL;
+    indice->totalDias = 0;
+    indice->capacidadeDias = 0;
+}
+
+void datasLiberar(IndiceDatas* indice) {
+    multiLiberar(&indice->porDia);
+    free(indice->dias);
+    indice->dias = NULL;
+    indice->totalDias = 0;
+    indice->capacidadeDias = 0;
+}
+
+// Posicao do primeiro dia >= 'dia' no vetor ordenado.
+int datasPrimeiroDia(const IndiceDatas* indice, int dia) {
+    int inicio = 0, fim = indice->totalDias;
+    while (inicio < fim) {
+        int meio = inicio + (fim - inicio) / 2;
+        if (indice->dias[meio] < dia) inicio = meio + 1;
+        else fim = meio;
+    }
+    return inicio;
+}
+
+void datasAdicionar(IndiceDatas* indice, int dia, int posicao) {
+    if (dia <= 0) return;
+    if (multiBuscar(&indice->porDia, (unsigned long long)dia) == NULL) {
+        if (indice->totalDias == indice->capacidadeDias) {
+            int novaCapacidade = indice->capacidadeDias > 0 ? indice->capacidadeDias * 2 : 64;
+            int* novos = realloc(indice->dias, novaCapacidade * sizeof(int));
+            if (novos == NULL) {
+                printf("ERRO CRITICO: Falha ao alocar memoria para o indice!\n");
+                exit(EXIT_FAILURE);
+            }
+            indice->dias = novos;
+            indice->capacidadeDias = novaCapacidade;
+        }
+        int i = datasPrimeiroDia(indice, dia);
+        memmove(&indice->dias[i + 1], &indice->dias[i], (indice->totalDias - i) * sizeof(int));
+        indice->dias[i] = dia;
+        indice->totalDias++;
+    }
+    multiAdicionar(&indice->porDia, (unsigned long long)dia, posicao);
+}
+
+// O dia continua no vetor mesmo se a lista dele esvaziar; a varredura so o pula.
+void datasRemover(IndiceDatas* indice, int dia, int posicao) {
+    if (dia <= 0) return;
+    multiRemover(&indice->porDia, (unsigned long long)dia, posicao);
+}
+
+const ListaPosicoes* datasOrdensDoDia(const IndiceDatas* indice, int dia) {
+    return multiBuscar(&indice->porDia, (unsigned long long)dia);
+}
+
+void construirIndiceDatas(IndiceDatas* indice, const ColunasOrdens* colunas) {
+    datasIniciar(indice, colunas->total);
+    for (int i = 0; i < colunas->total; i++) {
+        if (colunas->ids[i] != 0) datasAdicionar(indice, colunas->dias[i], i);
+    }
+}
+
+// Indice invertido sobre descricao_problema: cada termo (proximoTermo) aponta
+// para a lista ordenada dos IDs das ordens que o contem. Os termos ficam numa
+// tabela hash propria (a chave e o texto, nao um numero).
+#define ARQUIVO_INDICE_TEXTUAL "ordens.idx"
+#define INDICE_TEXTUAL_VERSAO 2
+
+typedef struct {
+    char texto[TERMO_MAXIMO + 1];
+    ListaPosicoes ids;
+} TermoIndice;
+
+typedef struct {
+    TermoIndice* termos;
+    int totalTermos;
+    int capacidadeTermos;
+    int* tabela;
+    int capacidadeTabela;
+} IndiceTextual;
+
+static unsigned long long hashTermo(const char* termo) {
+    unsigned long long hash = 1469598103934665603ULL;
+    while (*termo != '\0') {
+        hash ^= (unsigned char)*termo++;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void textualIniciar(IndiceTextual* indice) {
+    indice->termos = NULL;
+    indice->totalTermos = 0;
+    indice->capacidadeTermos = 0;
+    indice->tabela = NULL;
+    indice->capacidadeTabela = 0;
+}
+
+void textualLiberar(IndiceTextual* indice) {
+    for (int i = 0; i < indice->totalTermos; i++) free(indice->termos[i].ids.posicoes);
+    free(indice->termos);
+    free(indice->tabela);
+    textualIniciar(indice);
+}
+
+// Posicao do termo na tabela hash: a que o contem ou a vaga onde entraria.
+static int textualLocalizar(const IndiceTextual* indice, const char* termo) {
+    int mascara = indice->capacidadeTabela - 1;
+    int i = (int)(hashTermo(termo) & (unsigned long long)mascara);
+    while (indice->tabela[i] != -1 && strcmp(indice->termos[indice->tabela[i]].texto, termo) != 0) {
+        i = (i + 1) & mascara;
+    }
+    return i;
+}
+
+const ListaPosicoes* textualBuscar(const IndiceTextual* indice, const char* termo) {
+    if (indice->capacidadeTabela == 0) return NULL;
+    int numero = indice->tabela[textualLocalizar(indice, termo)];
+    return numero != -1 ? &indice->termos[numero].ids : NULL;
+}
+
+static void textualCrescerTabela(IndiceTextual* indice) {
+    int novaCapacidade = indice->capacidadeTabela > 0 ? indice->capacidadeTabela * 2 : 1024;
+    int* nova = malloc(novaCapacidade * sizeof(int));
+    if (nova == NULL) {
+        printf("ERRO CRITICO: Falha ao alocar memoria para o indice de busca!\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(nova, 0xFF, novaCapacidade * sizeof(int));
+    free(indice->tabela);
+    indice->tabela = nova;
+    indice->capacidadeTabela = novaCapacidade;
+    for (int numero = 0; numero < indice->totalTermos; numero++) {
+        indice->tabela[textualLocalizar(indice, indice->termos[numero].texto)] = numero;
+    }
+}
+
+static ListaPosicoes* textualObterTermo(IndiceTextual* indice, const char* termo) {
+    if ((indice->totalTermos + 1) * 4 > indice->capacidadeTabela * 3) textualCrescerTabela(indice);
+    int vaga = textualLocalizar(indice, termo);
+    if (indice->tabela[vaga] != -1) return &indice->termos[indice->tabela[vaga]].ids;
+
+    if (indice->totalTermos == indice->capacidadeTermos) {
+        int novaCapacidade = indice->capacidadeTermos > 0 ? indice->capacidadeTermos * 2 : 256;
+        TermoIndice* novos = realloc(indice->termos, novaCapacidade * sizeof(TermoIndice));
+        if (novos == NULL) {
+            printf("ERRO CRITICO: Falha ao alocar memoria para o indice de busca!\n");
+            exit(EXIT_FAILURE);
+        }
+        indice->termos = novos;
+        indice->capacidadeTermos = novaCapacidade;
+    }
+    TermoIndice* novo = &indice->termos[indice->totalTermos];
+    strcpy(novo->texto, termo);
+    novo->ids.posicoes = NULL;
+    novo->ids.total = 0;
+    novo->ids.capacidade = 0;
+    indice->tabela[vaga] = indice->totalTermos++;
+    return &novo->ids;
+}
+
+// Primeira posicao da lista com valor >= 'id'.
+static int listaPrimeiroMaiorOuIgual(const ListaPosicoes* lista, int id) {
+    int inicio = 0, fim = lista->total;
+    while (inicio < fim) {
+        int meio = inicio + (fim - inicio) / 2;
+        if (lista->posicoes[meio] < id) inicio = meio + 1;
+        else fim = meio;
+    }
+    return inicio;
+}
+
+// Os IDs chegam quase sempre em ordem crescente, entao o caso comum e anexar.
+static void textualAdicionarId(ListaPosicoes* lista, int id) {
+    int i = lista->total;
+    if (i > 0 && lista->posicoes[i - 1] >= id) {
+        i = listaPrimeiroMaiorOuIgual(lista, id);
+        if (i < lista->total && lista->posicoes[i] == id) return;
+    }
+    if (lista->total == lista->capacidade) {
+        int novaCapacidade = lista->capacidade > 0 ? lista->capacidade * 2 : 4;
+        int* novas = realloc(lista->posicoes, novaCapacidade * sizeof(int));
+        if (novas == NULL) {
+            printf("ERRO CRITICO: Falha ao alocar memoria para o indice de busca!\n");
+            exit(EXIT_FAILURE);
+        }
+        lista->posicoes = novas;
+        lista->capacidade = novaCapacidade;
+    }
+    memmove(&lista->posicoes[i + 1], &lista->posicoes[i], (lista->total - i) * sizeof(int));
+    lista->posicoes[i] = id;
+    lista->total++;
+}
+
+void textualAdicionar(IndiceTextual* indice, int id, const char* descricao) {
+    char termo[TERMO_MAXIMO + 1];
+    while (proximoTermo(&descricao, termo)) textualAdicionarId(textualObterTermo(indice, termo), id);
+}
+
+// O termo continua na tabela mesmo se a lista esvaziar.
+void textualRemover(IndiceTextual* indice, int id, const char* descricao) {
+    char termo[TERMO_MAXIMO + 1];
+    while (proximoTermo(&descricao, termo)) {
+        ListaPosicoes* lista = (ListaPosicoes*)textualBuscar(indice, termo);
+        if (lista == NULL) continue;
+        int i = listaPrimeiroMaiorOuIgual(lista, id);
+        if (i < lista->total && lista->posicoes[i] == id) {
+            memmove(&lista->posicoes[i], &lista->posicoes[i + 1], (lista->total - i - 1) * sizeof(int));
+            lista->total--;
+        }
+    }
+}
+
+void construirIndiceTextual(IndiceTextual* indice, const Vetor* ordens) {
+    textualIniciar(indice);
+    for (int i = 0; i < ordens->total; i++) {
+        if (!vetorAtivo(ordens, i)) continue;
+        OrdemServico ordem;
+        vetorLer(ordens, i, &ordem);
+        textualAdicionar(indice, ordem.id, ordem.descricao_problema);
+    }
+}
+
+// IDs das ordens que contem todos os termos da consulta, em ordem crescente.
+// A intersecao comeca pela menor lista. Retorna -1 se faltar memoria e 0 se
+// a consulta nao tiver nenhum termo pesquisavel.
+int textualConsultar(const IndiceTextual* indice, const char* consulta, ListaPosicoes* resultado) {
+    const ListaPosicoes* listas[16];
+    int totalListas = 0;
+    char termo[TERMO_MAXIMO + 1];
+    resultado->total = 0;
+    while (totalListas < 16 && proximoTermo(&consulta, termo)) {
+        const ListaPosicoes* lista = textualBuscar(indice, termo);
+        if (lista == NULL || lista->total == 0) return 1;
+        listas[totalListas++] = lista;
+    }
+    if (totalListas == 0) return 0;
+
+    int menor = 0;
+    for (int i = 1; i < totalListas; i++) {
+        if (listas[i]->total < listas[menor]->total) menor = i;
+    }
+    if (resultado->capacidade < listas[menor]->total) {
+        int* novas = realloc(resultado->posicoes, listas[menor]->total * sizeof(int));
+        if (novas == NULL) return -1;
+        resultado->posicoes = novas;
+        resultado->capacidade = listas[menor]->total;
+    }
+    memcpy(resultado->posicoes, listas[menor]->posicoes, listas[menor]->total * sizeof(int));
+    resultado->total = listas[menor]->total;
+
+    for (int l = 0; l < totalListas && resultado->total > 0; l++) {
+        if (l == menor) continue;
+        const ListaPosicoes* outra = listas[l];
+        int mantidos = 0, j = 0;
+        for (int i = 0; i < resultado->total; i++) {
+            while (j < outra->total && outra->posicoes[j] < resultado->posicoes[i]) j++;
+            if (j == outra->total) break;
+            if (outra->posicoes[j] == resultado->posicoes[i]) resultado->posicoes[mantidos++] = resultado->posicoes[i];
+        }
+        resultado->total = mantidos;
+    }
+    return 1;
+}
+
+// Indice de nomes de clientes: vetor ordenado pela forma normalizada do nome
+// (normalizarTexto). Insercoes vao para o fim e so sao ordenadas na proxima
+// consulta, o que mantem a importacao em lote barata; remocoes apenas marcam a
+// entrada (posicao -1) e sao descartadas na mesma reorganizacao.
+//
+// Para a busca aproximada ha um segundo vetor ordenado com uma entrada por
+// palavra do nome: o restante do nome a partir da palavra, truncado em
+// PALAVRA_CHAVE - 1 letras para nao multiplicar a memoria do indice.
+#define NOME_CHAVE 100
+#define PALAVRA_CHAVE 32
+#define NOME_DISTANCIA_MAXIMA 2
+
+typedef struct {
+    char chave[NOME_CHAVE];
+    int posicao;
+} EntradaNome;
+
+typedef struct {
+    char chave[PALAVRA_CHAVE];
+    int posicao;
+} EntradaPalavra;
+
+typedef struct {
+    EntradaNome* entradas;
+    int total;
+    int ordenadas;
+    int removidas;
+    int capacidade;
+    EntradaPalavra* palavras;
+    int totalPalavras;
+    int capacidadePalavras;
+} IndiceNomes;
+
+typedef struct {
+    int posicao;
+    int distancia;
+} CandidatoNome;
+
+void nomesIniciar(IndiceNomes* indice) {
+    indice->entradas = NULL;
+    indice->total = 0;
+    indice->ordenadas = 0;
+    indice->removidas = 0;
+    indice->capacidade = 0;
+    indice->palavras = NULL;
+    indice->totalPalavras = 0;
+    indice->capacidadePalavras = 0;
+}
+
+void nomesLiberar(IndiceNomes* indice) {
+    free(indice->entradas);
+    free(indice->palavras);
+    nomesIniciar(indice);
+}
+
+static int compararEntradasNome(const void* a, const void* b) {
+    const EntradaNome* x = a;
+    const EntradaNome* y = b;
+    int comparacao = strcmp(x->chave, y->chave);
+    if (comparacao != 0) return comparacao;
+    return (x->posicao > y->posicao) - (x->posicao < y->posicao);
+}
+
+static int compararEntradasPalavra(const void* a, const void* b) {
+    const EntradaPalavra* x = a;
+    const EntradaPalavra* y = b;
+    int comparacao = strcmp(x->chave, y->chave);
+    if (comparacao != 0) return comparacao;
+    return (x->posicao > y->posicao) - (x->posicao < y->posicao);
+}
+
+// Ordena as insercoes pendentes e descarta as entradas removidas, nos dois
+// vetores (as palavras sao acrescentadas e removidas junto com o nome).
+static void nomesOrganizar(IndiceNomes* indice) {
+    if (indice->ordenadas == indice->total && indice->removidas == 0) return;
+    int mantidas = 0;
+    for (int i = 0; i < indice->total; i++) {
+        if (indice->entradas[i].posicao != -1) indice->entradas[mantidas++] = indice->entradas[i];
+    }
+    indice->total = mantidas;
+    mantidas = 0;
+    for (int i = 0; i < indice->totalPalavras; i++) {
+        if (indice->palavras[i].posicao != -1) indice->palavras[mantidas++] = indice->palavras[i];
+    }
+    indice->totalPalavras = mantidas;
+    indice->removidas = 0;
+    qsort(indice->entradas, (size_t)indice->total, sizeof(EntradaNome), compararEntradasNome);
+    qsort(indice->palavras, (size_t)indice->totalPalavras, sizeof(EntradaPalavra), compararEntradasPalavra);
+    indice->ordenadas = indice->total;
+}
+
+// Copia para 'destino' o restante do nome a partir de 'palavra', truncado.
+static void chavePalavra(const char* palavra, char* destino) {
+    size_t tamanho = strlen(palavra);
+    if (tamanho > PALAVRA_CHAVE - 1) tamanho = PALAVRA_CHAVE - 1;
+    memcpy(destino, palavra, tamanho);
+    destino[tamanho] = '\0';
+}
+
+void nomesAdicionar(IndiceNomes* indice, const char* nome, int posicao) {
+    if (indice->total == indice->capacidade) {
+        int novaCapacidade = indice->capacidade > 0 ? indice->capacidade * 2 : 64;
+        EntradaNome* novas = realloc(indice->entradas, novaCapacidade * sizeof(EntradaNome));
+        if (novas == NULL) {
+            printf("ERRO CRITICO: Falha ao alocar memoria para o indice de nomes!\n");
+            exit(EXIT_FAILURE);
+        }
+        indice->entradas = novas;
+        indice->capacidade = novaCapacidade;
+    }
+    normalizarTexto(nome, indice->entradas[indice->total].chave);
+    indice->entradas[indice->total].posicao = posicao;
+    const char* chave = indice->entradas[indice->total].chave;
+    indice->total++;
+
+    for (const char* palavra = chave; palavra != NULL; palavra = strchr(palavra, ' ')) {
+        if (*palavra == ' ') palavra++;
+        if (indice->totalPalavras == indice->capacidadePalavras) {
+            int novaCapacidade = indice->capacidadePalavras > 0 ? indice->capacidadePalavras * 2 : 128;
+            EntradaPalavra* novas = realloc(indice->palavras, novaCapacidade * sizeof(EntradaPalavra));
+            if (novas == NULL) {
+                printf("ERRO CRITICO: Falha ao alocar memoria para o indice de nomes!\n");
+                exit(EXIT_FAILURE);
+            }
+            indice->palavras = novas;
+            indice->capacidadePalavras = novaCapacidade;
+        }
+        chavePalavra(palavra, indice->palavras[indice->totalPalavras].chave);
+        indice->palavras[indice->totalPalavras].posicao = posicao;
+        indice->totalPalavras++;
+    }
+}
+
+// Primeira entrada ordenada com chave >= 'chave'.
+static int nomesPrimeiraChave(const IndiceNomes* indice, const char* chave) {
+    int inicio = 0, fim = indice->ordenadas;
+    while (inicio < fim) {
+        int meio = inicio + (fim - inicio) / 2;
+        if (strcmp(indice->entradas[meio].chave, chave) < 0) inicio = meio + 1;
+        else fim = meio;
+    }
+    return inicio;
+}
+
+// Primeira palavra ordenada com chave >= 'chave'.
+static int palavrasPrimeiraChave(const IndiceNomes* indice, const char* chave) {
+    int inicio = 0, fim = indice->totalPalavras;
+    while (inicio < fim) {
+        int meio = inicio + (fim - inicio) / 2;
+        if (strcmp(indice->palavras[meio].chave, chave) < 0) inicio = meio + 1;
+        else fim = meio;
+    }
+    return inicio;
+}
+
+static void palavrasRemover(IndiceNomes* indice, const char* chave, int posicao) {
+    for (const char* palavra = chave; palavra != NULL; palavra = strchr(palavra, ' ')) {
+        if (*palavra == ' ') palavra++;
+        char chaveDaPalavra[PALAVRA_CHAVE];
+        chavePalavra(palavra, chaveDaPalavra);
+        for (int i = palavrasPrimeiraChave(indice, chaveDaPalavra);
+             i < indice->totalPalavras && strcmp(indice->palavras[i].chave, chaveDaPalavra) == 0; i++) {
+            if (indice->palavras[i].posicao == posicao) {
+                indice->palavras[i].posicao = -1;
+                break;
+            }
+        }
+    }
+}
+
+void nomesRemover(IndiceNomes* indice, const char* nome, int posicao) {
+    char chave[NOME_CHAVE];
+    normalizarTexto(nome, chave);
+    nomesOrganizar(indice);
+    for (int i = nomesPrimeiraChave(indice, chave); i < indice->total && strcmp(indice->entradas[i].chave, chave) == 0; i++) {
+        if (indice->entradas[i].posicao == posicao) {
+            indice->entradas[i].posicao = -1;
+            indice->removidas++;
+            palavrasRemover(indice, chave, posicao);
+            return;
+        }
+    }
+}
+
+void construirIndiceNomes(IndiceNomes* indice, const Vetor* clientes) {
+    nomesIniciar(indice);
+    for (int i = 0; i < clientes->total; i++) {
+        if (!vetorAtivo(clientes, i)) continue;
+        Cliente cliente;
+        vetorLer(clientes, i, &cliente);
+        nomesAdicionar(indice, cliente.nome, i);
+    }
+    nomesOrganizar(indice);
+}
+
+// Distancia de edicao (Levenshtein) entre 'consulta' e o prefixo de 'texto'
+// que mais se aproxima dela, ou limite + 1 se passar do limite. Coluna a
+// coluna sobre 'texto', parando assim que nenhuma celula ficar dentro do limite.
+static int distanciaPrefixo(const char* consulta, int tamanhoConsulta, const char* texto, int limite) {
+    int coluna[NOME_CHAVE];
+    for (int i = 0; i <= tamanhoConsulta; i++) coluna[i] = i;
+    int melhor = coluna[tamanhoConsulta];
+    for (int j = 1; texto[j - 1] != '\0' && melhor > 0; j++) {
+        int diagonal = coluna[0];
+        int menorDaColuna = coluna[0] = j;
+        for (int i = 1; i <= tamanhoConsulta; i++) {
+            int acima = coluna[i];
+            int custo = diagonal + (consulta[i - 1] != texto[j - 1]);
+            if (acima + 1 < custo) custo = acima + 1;
+            if (coluna[i - 1] + 1 < custo) custo = coluna[i - 1] + 1;
+            coluna[i] = custo;
+            diagonal = acima;
+            if (custo < menorDaColuna) menorDaColuna = custo;
+        }
+        if (coluna[tamanhoConsulta] < melhor) melhor = coluna[tamanhoConsulta];
+        if (menorDaColuna > limite) break;
+    }
+    return melhor <= limite ? melhor : limite + 1;
+}
+
+static int compararCandidatos(const void* a, const void* b) {
+    const CandidatoNome* x = a;
+    const CandidatoNome* y = b;
+    if (x->distancia != y->distancia) return x->distancia - y->distancia;
+    return x->posicao - y->posicao;
+}
+
+// Ate 'maximo' clientes cujo nome comeca com a consulta ou, se nenhum
+// comecar, cujo nome tem uma palavra que se aproxima dela (distancia de
+// edicao ate NOME_DISTANCIA_MAXIMA; ate 1 para consultas curtas), dos mais
+// proximos para os menos proximos, de modo que "souza" encontre "ana souza".
+// Nomes que comecam exatamente com a consulta sao achados por busca binaria.
+// A busca aproximada so compara as palavras que comecam com a mesma letra da
+// consulta, achadas por busca binaria no vetor de palavras: custa uma
+// distancia de edicao por palavra desse trecho (cerca de 1/26 das palavras),
+// nao por cliente cadastrado, e nao tolera erro na primeira letra. Consultas
+// longas demais para a chave truncada das palavras so sao achadas pelo inicio
+// do nome. Retorna quantos foram achados, ou -1 se faltar memoria.
+int buscarClientesPorNome(IndiceNomes* indice, const char* consulta, CandidatoNome* candidatos, int maximo) {
+    char chave[NOME_CHAVE];
+    if (strlen(consulta) >= NOME_CHAVE) return 0;
+    normalizarTexto(consulta, chave);
+    int tamanho = (int)strlen(chave);
+    if (tamanho == 0 || maximo <= 0) return 0;
+    nomesOrganizar(indice);
+
+    int total = 0;
+    for (int i = nomesPrimeiraChave(indice, chave); i < indice->total && total < maximo; i++) {
+        if (strncmp(indice->entradas[i].chave, chave, (size_t)tamanho) != 0) break;
+        candidatos[total].posicao = indice->entradas[i].posicao;
+        candidatos[total].distancia = 0;
+        total++;
+    }
+    int limite = tamanho <= 4 ? 1 : NOME_DISTANCIA_MAXIMA;
+    if (total > 0 || tamanho + limite >= PALAVRA_CHAVE) return total;
+
+    // Varredura aproximada do trecho da letra inicial: guarda os achados em um
+    // vetor auxiliar e, depois de ordenar, fica com os 'maximo' primeiros
+    // clientes distintos (um nome pode ter varias palavras no trecho).
+    char inicial[2] = { chave[0], '\0' };
+    CandidatoNome* achados = NULL;
+    int totalAchados = 0, capacidadeAchados = 0;
+    for (int i = palavrasPrimeiraChave(indice, inicial); i < indice->totalPalavras && indice->palavras[i].chave[0] == chave[0]; i++) {
+        int distancia = distanciaPrefixo(chave, tamanho, indice->palavras[i].chave, limite);
+        if (distancia > limite) continue;
+        if (totalAchados == capacidadeAchados) {
+            int novaCapacidade = capacidadeAchados > 0 ? capacidadeAchados * 2 : 64;
+            CandidatoNome* novos = realloc(achados, novaCapacidade * sizeof(CandidatoNome));
+            if (novos == NULL) {
+                free(achados);
+                return -1;
+            }
+            achados = novos;
+            capacidadeAchados = novaCapacidade;
+        }
+        // A posicao no vetor de palavras desempata pela ordem alfabetica.
+        achados[totalAchados].posicao = i;
+        achados[totalAchados].distancia = distancia;
+        totalAchados++;
+    }
+    qsort(achados, (size_t)totalAchados, sizeof(CandidatoNome), compararCandidatos);
+    for (int i = 0; i < totalAchados && total < maximo; i++) {
+        int posicao = indice->palavras[achados[i].posicao].posicao;
+        int repetido = 0;
+        for (int j = 0; j < total && !repetido; j++) repetido = candidatos[j].posicao == posicao;
+        if (repetido) continue;
+        candidatos[total].posicao = posicao;
+        candidatos[total].distancia = achados[i].distancia;
+        total++;
+    }
+    free(achados);
+    return total;
+}
+
+// Arquivo ordens.idx: cabecalho, termos (tamanho, texto, quantidade, IDs) e
+// um CRC do conteudo, com inteiros em 32 bits little-endian como nos .dat. O
+// cabecalho guarda quantas ordens havia em ordens.dat, o maior ID e o CRC do
+// cabecalho de ordens.dat quando o indice foi gravado; se nao baterem com a
+// tabela carregada (inclusive um .idx antigo que sobrou de uma queda entre a
+// gravacao dos dois arquivos), o indice e reconstruido a partir das ordens.
+#define INDICE_TEXTUAL_CABECALHO_BYTES 24
+#define INDICE_TEXTUAL_BLOCO_IDS 1024
+
+// CRC do cabecalho de ordens.dat (formato 2), ou 0 se nao houver um.
+static unsigned int impressaoOrdens() {
+    unsigned char cabecalho[FORMATO_CABECALHO_BYTES];
+    FILE* arquivo = fopen("ordens.dat", "rb");
+    if (arquivo == NULL) return 0;
+    int lido = fread(cabecalho, sizeof(cabecalho), 1, arquivo) == 1;
+    fclose(arquivo);
+    if (!lido || memcmp(cabecalho, FORMATO_MAGICA, 4) != 0) return 0;
+    return lerU32(cabecalho + 24);
+}
+
+static void gravarBytesIndice(FILE* arquivo, const unsigned char* bytes, size_t tamanho, unsigned int* crc) {
+    *crc = calcularCRC32(*crc, bytes, tamanho);
+    fwrite(bytes, 1, tamanho, arquivo);
+}
+
+static int lerBytesIndice(FILE* arquivo, unsigned char* bytes, size_t tamanho, unsigned int* crc) {
+    if (fread(bytes, 1, tamanho, arquivo) != tamanho) return 0;
+    *crc = calcularCRC32(*crc, bytes, tamanho);
+    return 1;
+}
+
+int salvarIndiceTextual(const IndiceTextual* indice, int totalOrdens, int maiorId) {
+    char temporario[64];
+    snprintf(temporario, sizeof(temporario), "%s.tmp", ARQUIVO_INDICE_TEXTUAL);
+    FILE* arquivo = fopen(temporario, "wb");
+    if (arquivo == NULL) return 0;
+
+    int totalTermos = 0;
+    for (int i = 0; i < indice->totalTermos; i++) {
+        if (indice->termos[i].ids.total > 0) totalTermos++;
+    }
+    unsigned char cabecalho[INDICE_TEXTUAL_CABECALHO_BYTES];
+    memcpy(cabecalho, "OIDX", 4);
+    escreverU32(cabecalho + 4, INDICE_TEXTUAL_VERSAO);
+    escreverU32(cabecalho + 8, (unsigned int)totalOrdens);
+    escreverU32(cabecalho + 12, (unsigned int)maiorId);
+    escreverU32(cabecalho + 16, (unsigned int)totalTermos);
+    escreverU32(cabecalho + 20, impressaoOrdens());
+    unsigned int crc = 0;
+    gravarBytesIndice(arquivo, cabecalho, sizeof(cabecalho), &crc);
+
+    unsigned char bytes[INDICE_TEXTUAL_BLOCO_IDS * 4];
+    for (int i = 0; i < indice->totalTermos; i++) {
+        const TermoIndice* termo = &indice->termos[i];
+        if (termo->ids.total == 0) continue;
+        bytes[0] = (unsigned char)strlen(termo->texto);
+        memcpy(bytes + 1, termo->texto, bytes[0]);
+        escreverU32(bytes + 1 + bytes[0], (unsigned int)termo->ids.total);
+        gravarBytesIndice(arquivo, bytes, (size_t)bytes[0] + 5, &crc);
+        for (int inicio = 0; inicio < termo->ids.total; inicio += INDICE_TEXTUAL_BLOCO_IDS) {
+            int quantidade = termo->ids.total - inicio;
+            if (quantidade > INDICE_TEXTUAL_BLOCO_IDS) quantidade = INDICE_TEXTUAL_BLOCO_IDS;
+            for (int k = 0; k < quantidade; k++) escreverU32(bytes + 4 * k, (unsigned int)termo->ids.posicoes[inicio + k]);
+            gravarBytesIndice(arquivo, bytes, (size_t)quantidade * 4, &crc);
+        }
+    }
+    escreverU32(bytes, crc);
+    fwrite(bytes, 1, 4, arquivo);
+
+    int sucesso = !ferror(arquivo) && sincronizarArquivo(arquivo);
+    if (fclose(arquivo) != 0) sucesso = 0;
+    if (!sucesso) {
+        remove(temporario);
+        return 0;
+    }
+    #ifdef _WIN32
+        remove(ARQUIVO_INDICE_TEXTUAL);
+    #endif
+    return rename(temporario, ARQUIVO_INDICE_TEXTUAL) == 0;
+}
+
+// Retorna 1 se o indice gravado for valido e corresponder as ordens carregadas.
+int carregarIndiceTextual(IndiceTextual* indice, int totalOrdens, int maiorId) {
+    textualIniciar(indice);
+    FILE* arquivo = fopen(ARQUIVO_INDICE_TEXTUAL, "rb");
+    if (arquivo == NULL) return 0;
+
+    unsigned char bytes[INDICE_TEXTUAL_BLOCO_IDS * 4];
+    unsigned int crc = 0;
+    int valido = lerBytesIndice(arquivo, bytes, INDICE_TEXTUAL_CABECALHO_BYTES, &crc) &&
+                 memcmp(bytes, "OIDX", 4) == 0 && lerU32(bytes + 4) == INDICE_TEXTUAL_VERSAO &&
+                 lerU32(bytes + 8) == (unsigned int)totalOrdens && lerU32(bytes + 12) == (unsigned int)maiorId &&
+                 lerU32(bytes + 20) == impressaoOrdens();
+    int totalTermos = valido ? (int)lerU32(bytes + 16) : 0;
+    char termo[TERMO_MAXIMO + 1];
+    for (int t = 0; valido && t < totalTermos; t++) {
+        unsigned char tamanho;
+        valido = lerBytesIndice(arquivo, &tamanho, 1, &crc) && tamanho >= TERMO_MINIMO && tamanho <= TERMO_MAXIMO &&
+                 lerBytesIndice(arquivo, bytes, (size_t)tamanho + 4, &crc);
+        if (!valido) break;
+        memcpy(termo, bytes, tamanho);
+        termo[tamanho] = '\0';
+        unsigned int quantidade = lerU32(bytes + tamanho);
+        ListaPosicoes* lista = textualObterTermo(indice, termo);
+        if (quantidade == 0 || quantidade > (unsigned int)totalOrdens || lista->total > 0) { valido = 0; break; }
+        lista->posicoes = malloc(quantidade * sizeof(int));
+        if (lista->posicoes == NULL) {
+            printf("ERRO CRITICO: Falha ao alocar memoria para o indice de busca!\n");
+            exit(EXIT_FAILURE);
+        }
+        lista->capacidade = (int)quantidade;
+        for (int inicio = 0; valido && inicio < (int)quantidade; inicio += INDICE_TEXTUAL_BLOCO_IDS) {
+            int parte = (int)quantidade - inicio;
+            if (parte > INDICE_TEXTUAL_BLOCO_IDS) parte = INDICE_TEXTUAL_BLOCO_IDS;
+            valido = lerBytesIndice(arquivo, bytes, (size_t)parte * 4, &crc);
+            for (int k = 0; valido && k < parte; k++) lista->posicoes[inicio + k] = (int)lerU32(bytes + 4 * k);
+        }
+        if (valido) lista->total = (int)quantidade;
+    }
+    if (valido) valido = fread(bytes, 1, 4, arquivo) == 4 && lerU32(bytes) == crc;
+    fclose(arquivo);
+    if (!valido) textualLiberar(indice);
+    return valido;
+}
+
+// Ordens separadas por status: uma lista duplamente encadeada intrusiva por
+// StatusOrdem, guardada em vetores paralelos indexados pela posicao da ordem.
+// Mudar o status move a ordem de lista em O(1), a contagem de cada status e
+// mantida junto e percorrer um status so visita as ordens dele.
+#define TOTAL_STATUS (ENTREGUE + 1)
+#define FORA_DOS_CONJUNTOS -1
+
+typedef struct {
+    int* anterior;
+    int* proximo;
+    signed char* status;
+    int capacidade;
+    int primeiro[TOTAL_STATUS];
+    int ultimo[TOTAL_STATUS];
+    int contagem[TOTAL_STATUS];
+} ConjuntosStatus;
+
+void conjuntosIniciar(ConjuntosStatus* conjuntos) {
+    conjuntos->anterior = NULL;
+    conjuntos->proximo = NULL;
+    conjuntos->status = NULL;
+    conjuntos->capacidade = 0;
+    for (int s = 0; s < TOTAL_STATUS; s++) {
+        conjuntos->primeiro[s] = -1;
+        conjuntos->ultimo[s] = -1;
+        conjuntos->contagem[s] = 0;
+    }
+}
+
+void conjuntosLiberar(ConjuntosStatus* conjuntos) {
+    free(conjuntos->anterior);
+    free(conjuntos->proximo);
+    free(conjuntos->status);
+    conjuntosIniciar(conjuntos);
+}
+
+static void conjuntosReservar(ConjuntosStatus* conjuntos, int posicao) {
+    if (posicao < conjuntos->capacidade) return;
+    int novaCapacidade = conjuntos->capacidade > 0 ? conjuntos->capacidade : 64;
+    while (novaCapacidade <= posicao) novaCapacidade *= 2;
+    int* anterior = realloc(conjuntos->anterior, novaCapacidade * sizeof(int));
+    if (anterior != NULL) conjuntos->anterior = anterior;
+    int* proximo = realloc(conjuntos->proximo, novaCapacidade * sizeof(int));
+    if (proximo != NULL) conjuntos->proximo = proximo;
+    signed char* status = realloc(conjuntos->status, (size_t)novaCapacidade);
+    if (status != NULL) conjuntos->status = status;
+    if (anterior == NULL || proximo == NULL || status == NULL) {
+        printf("ERRO CRITICO: Falha ao alocar memoria para o indice de status!\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(conjuntos->status + conjuntos->capacidade, FORA_DOS_CONJUNTOS, (size_t)(novaCapacidade - conjuntos->capacidade));
+    conjuntos->capacidade = novaCapacidade;
+}
+
+void conjuntosRetirar(ConjuntosStatus* conjuntos, int posicao) {
+    if (posicao >= conjuntos->capacidade || conjuntos->status[posicao] == FORA_DOS_CONJUNTOS) return;
+    int s = conjuntos->status[posicao];
+    int anterior = conjuntos->anterior[posicao];
+    int proximo = conjuntos->proximo[posicao];
+    if (anterior != -1) conjuntos->proximo[anterior] = proximo;
+    else conjuntos->primeiro[s] = proximo;
+    if (proximo != -1) conjuntos->anterior[proximo] = anterior;
+    else conjuntos->ultimo[s] = anterior;
+    conjuntos->status[posicao] = FORA_DOS_CONJUNTOS;
+    conjuntos->contagem[s]--;
+}
+
+// Coloca a posicao no fim da lista do status (tirando-a da anterior, se for o
+// caso). Status fora do intervalo apenas retiram a posicao dos conjuntos.
+void conjuntosColocar(ConjuntosStatus* conjuntos, int posicao, int status) {
+    conjuntosReservar(conjuntos, posicao);
+    if (conjuntos->status[posicao] == status) return;
+    conjuntosRetirar(conjuntos, posicao);
+    if (status < 0 || status >= TOTAL_STATUS) return;
+    conjuntos->anterior[posicao] = conjuntos->ultimo[status];
+    conjuntos->proximo[posicao] = -1;
+    if (conjuntos->ultimo[status] != -1) conjuntos->proximo[conjuntos->ultimo[status]] = posicao;
+    else conjuntos->primeiro[status] = posicao;
+    conjuntos->ultimo[status] = posicao;
+    conjuntos->status[posicao] = (signed char)status;
+    conjuntos->contagem[status]++;
+}
+
+int conjuntosContar(const ConjuntosStatus* conjuntos, int status) {
+    return conjuntos->contagem[status];
+}
+
+// Percorre um status: for (p = conjuntosPrimeiro(c, s); p != -1; p = conjuntosProximo(c, p))
+int conjuntosPrimeiro(const ConjuntosStatus* conjuntos, int status) {
+    return conjuntos->primeiro[status];
+}
+
+int conjuntosProximo(const ConjuntosStatus* conjuntos, int posicao) {
+    return conjuntos->proximo[posicao];
+}
+
+void construirConjuntosStatus(ConjuntosStatus* conjuntos, const ColunasOrdens* colunas) {
+    conjuntosIniciar(conjuntos);
+    if (colunas->total > 0) conjuntosReservar(conjuntos, colunas->total - 1);
+    for (int i = 0; i < colunas->total; i++) {
+        if (colunas->ids[i] != 0) conjuntosColocar(conjuntos, i, colunas->status[i]);
+    }
+}
+
+
+// --- Diario de Operacoes ---
+
+// Cada alteracao e anexada ao diario como um registro pequeno (cabecalho +
+// copia do registro alterado) antes de ser aplicada na memoria. Ao iniciar, o
+// diario e reaplicado sobre os .dat; um checkpoint grava os .dat e esvazia o
+// diario. As operacoes sao idempotentes (inserir-ou-substituir pela chave e
+// remover-se-existir), entao reaplicar o diario sobre um .dat que ja contem
+// parte dele produz o mesmo estado final.
+#define ARQUIVO_DIARIO "diario.log"
+#define DIARIO_CARGA_MAXIMA 512
+#define DIARIO_LIMITE_CHECKPOINT (4L * 1024 * 1024)
+
+typedef enum {
+    DIARIO_CLIENTE_SALVO = 1,
+    DIARIO_CLIENTE_REMOVIDO,
+    DIARIO_VEICULO_SALVO,
+    DIARIO_VEICULO_REMOVIDO,
+    DIARIO_ORDEM_SALVA
+} TipoOperacao;
+
+typedef struct {
+    int tipo;
+    int tamanho;
+    unsigned int crc;
+} CabecalhoDiario;
+
+typedef struct {
+    FILE* arquivo;
+    int pendentes;
+    long tamanho;
+} Diario;
+
+static unsigned int crcRegistroDiario(int tipo, int tamanho, const void* dados) {
+    int campos[2] = { tipo, tamanho };
+    unsigned int crc = calcularCRC32(0, campos, sizeof(campos));
+    return calcularCRC32(crc, dados, (size_t)tamanho);
+}
+
+void diarioAbrir(Diario* diario) {
+    diario->pendentes = 0;
+    diario->tamanho = 0;
+    diario->arquivo = fopen(ARQUIVO_DIARIO, "ab");
+    if (diario->arquivo == NULL) {
+        exibirTela();
+        perror("Aviso: Nao foi possivel abrir o diario");
+        return;
+    }
+    fseek(diario->arquivo, 0, SEEK_END);
+    diario->tamanho = ftell(diario->arquivo);
+}
+
+void diarioFechar(Diario* diario) {
+    if (diario->arquivo != NULL) fclose(diario->arquivo);
+    diario->arquivo = NULL;
+}
+
+int diarioRegistrar(Diario* diario, int tipo, const void* dados, int tamanho) {
+    if (diario->arquivo == NULL) return 0;
+    CabecalhoDiario cabecalho;
+    cabecalho.tipo = tipo;
+    cabecalho.tamanho = tamanho;
+    cabecalho.crc = crcRegistroDiario(tipo, tamanho, dados);
+    if (fwrite(&cabecalho, sizeof(cabecalho), 1, diario->arquivo) != 1) return 0;
+    if (fwrite(dados, 1, (size_t)tamanho, diario->arquivo) != (size_t)tamanho) return 0;
+    diario->pendentes++;
+    diario->tamanho += (long)(sizeof(cabecalho) + (size_t)tamanho);
+    return 1;
+}
+
+// Commit em grupo: todas as operacoes registradas desde a ultima confirmacao
+// vao para o disco com um unico fsync.
+int diarioConfirmar(Diario* diario) {
+    if (diario->arquivo == NULL || diario->pendentes == 0) return 1;
+    diario->pendentes = 0;
+    return sincronizarArquivo(diario->arquivo);
+}
+
+void diarioEsvaziar(Diario* diario) {
+    diarioFechar(diario);
+    FILE* arquivo = fopen(ARQUIVO_DIARIO, "wb");
+    if (arquivo != NULL) fclose(arquivo);
+    diarioAbrir(diario);
+}
+
+
+// --- Instancias Compartilhadas ---
+
+// Varias copias do programa podem ficar abertas na mesma pasta (um por balcao)
+// sem que uma sobrescreva o trabalho da outra. Elas se coordenam por uma area
+// pequena mapeada de 'oficina.shm' (MAP_SHARED), com:
+//   - uma trava (mutex compartilhado entre processos, robusto: se o dono cair,
+//     a proxima instancia a obtem e descarta o que ele deixou pela metade);
+//   - o tamanho confirmado do diario, que e comum a todas as instancias;
+//   - um contador de versao por tabela, incrementado a cada alteracao;
+//   - os PIDs das instancias abertas.
+// Cada alteracao acontece com a trava obtida: a instancia primeiro aplica o
+// trecho do diario que as outras anexaram desde a ultima vez (sem recarregar
+// os .dat), valida e registra a operacao, e libera a trava. Os .dat so sao
+// regravados pela ultima instancia aberta; as demais deixam tudo no diario.
+// No Windows cada instancia continua trabalhando sozinha.
+#define ARQUIVO_COMPARTILHADO "oficina.shm"
+#define COMPARTILHADO_MAGICA 0x4F465348u
+#define INSTANCIAS_MAXIMO 32
+
+#ifndef _WIN32
+typedef struct {
+    unsigned int magica;
+    unsigned int versoes[TABELA_ORDENS];
+    long tamanhoDiario;
+    pid_t instancias[INSTANCIAS_MAXIMO];
+    pthread_mutex_t trava;
+} AreaCompartilhada;
+#else
+typedef struct {
+    unsigned int versoes[TABELA_ORDENS];
+    long tamanhoDiario;
+} AreaCompartilhada;
+#endif
+
+typedef struct {
+    AreaCompartilhada* area;    // NULL: instancia isolada
+    int vaga;
+    int profundidade;
+    unsigned int versoes[TABELA_ORDENS];
+    long diarioAplicado;        // -1 enquanto os dados nao foram carregados
+    int alteradas;              // bit (tabela - 1) das tabelas alteradas
+} Compartilhamento;
+
+#ifndef _WIN32
+
+static int instanciaViva(pid_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+// Entra na area da pasta atual. Sem ela (erro ao criar ou vagas esgotadas),
+// a instancia trabalha isolada, como antes.
+void compartilhamentoAbrir(Compartilhamento* compartilhamento) {
+    memset(compartilhamento, 0, sizeof(Compartilhamento));
+    compartilhamento->vaga = -1;
+    compartilhamento->diarioAplicado = -1;
+
+    int arquivo = open(ARQUIVO_COMPARTILHADO, O_RDWR | O_CREAT, 0644);
+    if (arquivo < 0) return;
+    // A entrada e serializada por uma trava do proprio arquivo, liberada pelo
+    // sistema se o processo cair; so ela pode reiniciar a area.
+    struct flock entrada;
+    memset(&entrada, 0, sizeof(entrada));
+    entrada.l_type = F_WRLCK;
+    entrada.l_whence = SEEK_SET;
+    AreaCompartilhada* area = MAP_FAILED;
+    if (fcntl(arquivo, F_SETLKW, &entrada) == 0 && ftruncate(arquivo, sizeof(AreaCompartilhada)) == 0) {
+        area = mmap(NULL, sizeof(AreaCompartilhada), PROT_READ | PROT_WRITE, MAP_SHARED, arquivo, 0);
+    }
+    if (area == MAP_FAILED) {
+        close(arquivo);
+        return;
+    }
+
+    int vivas = 0, vaga = -1;
+    for (int i = 0; i < INSTANCIAS_MAXIMO; i++) {
+        if (instanciaViva(area->instancias[i])) vivas++;
+        else area->instancias[i] = 0;
+    }
+    // Sem nenhuma instancia viva, nada do que esta na area vale mais (nem a
+    // trava, que pode ter ficado presa por um processo de antes do reboot).
+    if (area->magica != COMPARTILHADO_MAGICA || vivas == 0) {
+        memset(area, 0, sizeof(AreaCompartilhada));
+        pthread_mutexattr_t atributos;
+        pthread_mutexattr_init(&atributos);
+        pthread_mutexattr_setpshared(&atributos, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&atributos, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&area->trava, &atributos);
+        pthread_mutexattr_destroy(&atributos);
+        area->magica = COMPARTILHADO_MAGICA;
+    }
+    for (int i = 0; i < INSTANCIAS_MAXIMO && vaga == -1; i++) {
+        if (area->instancias[i] == 0) vaga = i;
+    }
+    if (vaga == -1) {
+        printf("Aviso: Instancias demais abertas nesta pasta; esta trabalhara isolada.\n");
+        munmap(area, sizeof(AreaCompartilhada));
+    } else {
+        area->instancias[vaga] = getpid();
+        compartilhamento->area = area;
+        compartilhamento->vaga = vaga;
+    }
+    close(arquivo);
+}
+
+void compartilhamentoFechar(Compartilhamento* compartilhamento) {
+    if (compartilhamento->area == NULL) return;
+    compartilhamento->area->instancias[compartilhamento->vaga] = 0;
+    munmap(compartilhamento->area, sizeof(AreaCompartilhada));
+    compartilhamento->area = NULL;
+}
+
+// Numero de outras instancias abertas na pasta.
+int compartilhamentoOutras(const Compartilhamento* compartilhamento) {
+    if (compartilhamento->area == NULL) return 0;
+    int outras = 0;
+    for (int i = 0; i < INSTANCIAS_MAXIMO; i++) {
+        if (i != compartilhamento->vaga && instanciaViva(compartilhamento->area->instancias[i])) outras++;
+    }
+    return outras;
+}
+
+// Descarta do diario o que foi anexado depois do ultimo tamanho publicado.
+// So e chamada com a trava obtida e com outras instancias vivas.
+static void compartilhamentoCortarDiario(Compartilhamento* compartilhamento) {
+    if (truncate(ARQUIVO_DIARIO, compartilhamento->area->tamanhoDiario) != 0 && errno != ENOENT) {
+        printf("AVISO: Nao foi possivel descartar o final incompleto do diario.\n");
+    }
+}
+
+static void compartilhamentoTravar(Compartilhamento* compartilhamento) {
+    if (pthread_mutex_lock(&compartilhamento->area->trava) == EOWNERDEAD) {
+        // O dono caiu no meio de uma alteracao: o que ele anexou ao diario
+        // depois do ultimo tamanho publicado nao vale.
+        compartilhamentoCortarDiario(compartilhamento);
+        pthread_mutex_consistent(&compartilhamento->area->trava);
+    }
+}
+
+static void compartilhamentoDestravar(Compartilhamento* compartilhamento) {
+    pthread_mutex_unlock(&compartilhamento->area->trava);
+}
+
+#else
+
+void compartilhamentoAbrir(Compartilhamento* compartilhamento) {
+    memset(compartilhamento, 0, sizeof(Compartilhamento));
+    compartilhamento->vaga = -1;
+    compartilhamento->diarioAplicado = -1;
+}
+
+void compartilhamentoFechar(Compartilhamento* compartilhamento) {
+    (void)compartilhamento;
+}
+
+int compartilhamentoOutras(const Compartilhamento* compartilhamento) {
+    (void)compartilhamento;
+    return 0;
+}
+
+static void compartilhamentoCortarDiario(Compartilhamento* compartilhamento) {
+    (void)compartilhamento;
+}
+
+static void compartilhamentoTravar(Compartilhamento* compartilhamento) {
+    (void)compartilhamento;
+}
+
+static void compartilhamentoDestravar(Compartilhamento* compartilhamento) {
+    (void)compartilhamento;
+}
+
+#endif
+
+
+// --- Verificacao de Integridade ---
+
+// Na carga, todos os registros das tres tabelas sao conferidos antes de
+// entrarem nos indices: formato dos campos (as mesmas regras do cadastro),
+// textos terminados, IDs e chaves duplicados, e referencias de veiculo para
+// cliente e de ordem para veiculo. Os campos sao validados em lotes de
+// VERIFICACAO_LOTE registros por rotinas sem desvios no laco interno, que o
+// compilador consegue vetorizar; as referencias e duplicatas usam conjuntos
+// hash com as chaves numericas de CPF, placa e ID.
+//
+// Registros com problema vao para o relatorio de integridade e, em seu
+// formato de importacao, para quarentena_<tabela>.csv, e saem das tabelas
+// (OFICINA_VERIFICACAO=relatar apenas relata e os mantem). Com outras
+// instancias abertas os .dat nao podem ser regravados; os registros so sao
+// relatados e vao para a quarentena, uma unica vez, na proxima abertura sem
+// outras instancias. As operacoes do diario reproduzidas na abertura passam
+// pelas mesmas regras (conferirOperacao); as reprovadas sao puladas.
+#define VERIFICACAO_LOTE 256
+#define ARQUIVO_RELATORIO_INTEGRIDADE "relatorio_integridade.txt"
+
+enum {
+    FALHA_TEXTO_ABERTO = 1,
+    FALHA_CPF = 2,
+    FALHA_PLACA = 4,
+    FALHA_NOME = 8,
+    FALHA_ANO = 16,
+    FALHA_STATUS = 32,
+    FALHA_ID = 64,
+    FALHA_DUPLICADO = 128,
+    FALHA_REFERENCIA = 256,
+    FALHA_OPERACAO = 512
+};
+
+typedef struct {
+    int quarentenar;
+    FILE* relatorio;
+    long problemas;
+    long quarentenados;
+} VerificacaoCarga;
+
+// Marca 'bit' nos registros cujo campo nao tem '\0' dentro do tamanho.
+static void loteTextoTerminado(const char* lote, size_t passo, size_t campo, size_t tamanho, int total, unsigned short* falhas) {
+    for (int i = 0; i < total; i++) {
+        const unsigned char* texto = (const unsigned char*)lote + i * passo + campo;
+        unsigned char terminado = 0;
+        for (size_t j = 0; j < tamanho; j++) terminado |= texto[j] == 0;
+        falhas[i] |= (unsigned short)(!terminado * FALHA_TEXTO_ABERTO);
+    }
+}
+
+// CPF: exatamente 11 digitos.
+static void loteCPF(const char* lote, size_t passo, size_t campo, int total, unsigned short* falhas) {
+    for (int i = 0; i < total; i++) {
+        const unsigned char* cpf = (const unsigned char*)lote + i * passo + campo;
+        unsigned char valido = cpf[11] == 0;
+        for (int j = 0; j < 11; j++) valido &= (unsigned char)(cpf[j] - '0') < 10;
+        falhas[i] |= (unsigned short)(!valido * FALHA_CPF);
+    }
+}
+
+// Placa: tres letras e quatro digitos (validarPlaca).
+static void lotePlaca(const char* lote, size_t passo, size_t campo, int total, unsigned short* falhas) {
+    for (int i = 0; i < total; i++) {
+        const unsigned char* placa = (const unsigned char*)lote + i * passo + campo;
+        unsigned char valido = placa[7] == 0;
+        for (int j = 0; j < 3; j++) valido &= (unsigned char)((placa[j] | 0x20) - 'a') < 26;
+        for (int j = 3; j < 7; j++) valido &= (unsigned char)(placa[j] - '0') < 10;
+        falhas[i] |= (unsigned short)(!valido * FALHA_PLACA);
+    }
+}
+
+// Nome: nao vazio, so letras e espacos ate o '\0' (validarNome).
+static void loteNome(const char* lote, size_t passo, size_t campo, size_t tamanho, int total, unsigned short* falhas) {
+    for (int i = 0; i < total; i++) {
+        const unsigned char* nome = (const unsigned char*)lote + i * passo + campo;
+        unsigned char fim = 0, valido = nome[0] != 0;
+        for (size_t j = 0; j < tamanho; j++) {
+            unsigned char c = nome[j];
+            fim |= c == 0;
+            valido &= fim | ((unsigned char)((c | 0x20) - 'a') < 26) | (c == ' ') | ((unsigned char)(c - '\t') < 5);
+        }
+        falhas[i] |= (unsigned short)(!valido * FALHA_NOME);
+    }
+}
+
+static void loteIntervalo(const char* lote, size_t passo, size_t campo, int minimo, int maximo, int total,
+                          unsigned short* falhas, unsigned short bit) {
+    for (int i = 0; i < total; i++) {
+        int valor;
+        memcpy(&valor, lote + i * passo + campo, sizeof(int));
+        falhas[i] |= (unsigned short)((valor < minimo || valor > maximo) * bit);
+    }
+}
+
+static const char* descreverFalhas(unsigned short falhas) {
+    if (falhas & FALHA_TEXTO_ABERTO) return "texto sem terminador (registro danificado)";
+    if (falhas & FALHA_ID) return "ID invalido";
+    if (falhas & FALHA_CPF) return "CPF invalido";
+    if (falhas & FALHA_PLACA) return "placa invalida";
+    if (falhas & FALHA_NOME) return "nome invalido";
+    if (falhas & FALHA_ANO) return "ano invalido";
+    if (falhas & FALHA_STATUS) return "status invalido";
+    if (falhas & FALHA_DUPLICADO) return "chave duplicada";
+    if (falhas & FALHA_OPERACAO) return "operacao do diario que nao pode ser aplicada";
+    return "referencia inexistente (cliente ou veiculo nao cadastrado)";
+}
+
+// Campo de texto para o CSV de quarentena: limitado ao tamanho do campo,
+// entre aspas e sem caracteres de controle.
+static void escreverCampoQuarentena(FILE* arquivo, const char* campo, size_t tamanho, int ultimo) {
+    fputc('"', arquivo);
+    for (size_t i = 0; i < tamanho && campo[i] != '\0'; i++) {
+        unsigned char c = (unsigned char)campo[i];
+        if (c == '"') fputs("\"\"", arquivo);
+        else fputc(c < 0x20 || c == 0x7F ? '?' : c, arquivo);
+    }
+    fputs(ultimo ? "\"\n" : "\",", arquivo);
+}
+
+// Anota o problema no relatorio de integridade, aberto no primeiro problema.
+static void relatarProblema(VerificacaoCarga* verificacao, const char* local, unsigned short falhas) {
+    verificacao->problemas++;
+    if (verificacao->relatorio == NULL) {
+        verificacao->relatorio = fopen(ARQUIVO_RELATORIO_INTEGRIDADE, "w");
+        if (verificacao->relatorio != NULL) {
+            fprintf(verificacao->relatorio, "Relatorio de Integridade - Verificacao na abertura\n");
+            fprintf(verificacao->relatorio, "==============================================\n");
+        }
+    }
+    if (verificacao->relatorio != NULL) {
+        fprintf(verificacao->relatorio, "%s: %s%s\n", local, descreverFalhas(falhas), verificacao->quarentenar ? "" : " (mantido)");
+    }
+}
+
+// Acrescenta o registro, no formato de importacao, a quarentena_<tabela>.csv.
+static void escreverQuarentena(TipoTabela tabela, const void* registro) {
+    static const char* arquivos[] = { NULL, "quarentena_clientes.csv", "quarentena_veiculos.csv", "quarentena_ordens.csv" };
+    static const char* cabecalhos[] = { NULL, "nome,cpf,telefone", "placa,modelo,ano,cpf_cliente", "placa,data_entrada,descricao,status" };
+    FILE* arquivo = fopen(arquivos[tabela], "a");
+    if (arquivo == NULL) return;
+    fseek(arquivo, 0, SEEK_END);
+    if (ftell(arquivo) == 0) fprintf(arquivo, "%s\n", cabecalhos[tabela]);
+    if (tabela == TABELA_CLIENTES) {
+        const Cliente* cliente = registro;
+        escreverCampoQuarentena(arquivo, cliente->nome, sizeof(cliente->nome), 0);
+        escreverCampoQuarentena(arquivo, cliente->cpf, sizeof(cliente->cpf), 0);
+        escreverCampoQuarentena(arquivo, cliente->telefone, sizeof(cliente->telefone), 1);
+    } else if (tabela == TABELA_VEICULOS) {
+        const Veiculo* veiculo = registro;
+        escreverCampoQuarentena(arquivo, veiculo->placa, sizeof(veiculo->placa), 0);
+        escreverCampoQuarentena(arquivo, veiculo->modelo, sizeof(veiculo->modelo), 0);
+        fprintf(arquivo, "%d,", veiculo->ano);
+        escreverCampoQuarentena(arquivo, veiculo->cpf_cliente, sizeof(veiculo->cpf_cliente), 1);
+    } else {
+        const OrdemServico* ordem = registro;
+        escreverCampoQuarentena(arquivo, ordem->placa_veiculo, sizeof(ordem->placa_veiculo), 0);
+        escreverCampoQuarentena(arquivo, ordem->data_entrada, sizeof(ordem->data_entrada), 0);
+        escreverCampoQuarentena(arquivo, ordem->descricao_problema, sizeof(ordem->descricao_problema), 0);
+        fprintf(arquivo, "%d\n", (int)ordem->status);
+    }
+    fclose(arquivo);
+}
+
+static void quarentenarRegistro(VerificacaoCarga* verificacao, Vetor* vetor, int posicao, const void* registro, unsigned short falhas) {
+    static const char* tabelas[] = { NULL, "clientes.dat", "veiculos.dat", "ordens.dat" };
+    char local[64];
+    snprintf(local, sizeof(local), "%s, registro %d", tabelas[vetor->tabela], posicao + 1);
+    relatarProblema(verificacao, local, falhas);
+    if (!verificacao->quarentenar) return;
+
+    escreverQuarentena(vetor->tabela, registro);
+    if (!vetorRemover(vetor, posicao)) {
+        printf("ERRO CRITICO: Falha ao alocar memoria durante a verificacao!\n");
+        exit(EXIT_FAILURE);
+    }
+    verificacao->quarentenados++;
+}
+
+// Uma operacao do diario reprovada na reproducao: com quarentena, o registro
+// gravado (se houver) vai para o CSV e a operacao nao e aplicada.
+static void quarentenarOperacao(VerificacaoCarga* verificacao, long posicao, int tipo, const void* carga, int tamanho, unsigned short falhas) {
+    char local[64];
+    snprintf(local, sizeof(local), "%s, byte %ld", ARQUIVO_DIARIO, posicao);
+    relatarProblema(verificacao, local, falhas);
+    if (!verificacao->quarentenar) return;
+
+    if (tipo == DIARIO_CLIENTE_SALVO && tamanho == (int)sizeof(Cliente)) escreverQuarentena(TABELA_CLIENTES, carga);
+    else if (tipo == DIARIO_VEICULO_SALVO && tamanho == (int)sizeof(Veiculo)) escreverQuarentena(TABELA_VEICULOS, carga);
+    else if (tipo == DIARIO_ORDEM_SALVA && tamanho == (int)sizeof(OrdemServico)) escreverQuarentena(TABELA_ORDENS, carga);
+    verificacao->quarentenados++;
+}
+
+// Copia os registros ativos de [inicio, inicio + total) para o lote; os
+// inativos ficam zerados e marcados em 'ativos'.
+static void carregarLote(const Vetor* vetor, int inicio, int total, char* lote, unsigned char* ativos, unsigned short* falhas) {
+    for (int i = 0; i < total; i++) {
+        falhas[i] = 0;
+        ativos[i] = vetorAtivo(vetor, inicio + i);
+        if (ativos[i]) vetorLer(vetor, inicio + i, lote + (size_t)i * vetor->tamanhoElemento);
+        else memset(lote + (size_t)i * vetor->tamanhoElemento, 0, vetor->tamanhoElemento);
+    }
+}
+
+static void verificarClientes(VerificacaoCarga* verificacao, Vetor* clientes, IndiceHash* cpfs) {
+    static Cliente lote[VERIFICACAO_LOTE];
+    unsigned char ativos[VERIFICACAO_LOTE];
+    unsigned short falhas[VERIFICACAO_LOTE];
+    const char* base = (const char*)lote;
+    unsigned long long chave;
+    for (int inicio = 0; inicio < clientes->total; inicio += VERIFICACAO_LOTE) {
+        int total = clientes->total - inicio < VERIFICACAO_LOTE ? clientes->total - inicio : VERIFICACAO_LOTE;
+        carregarLote(clientes, inicio, total, (char*)lote, ativos, falhas);
+        loteTextoTerminado(base, sizeof(Cliente), offsetof(Cliente, nome), sizeof(lote[0].nome), total, falhas);
+        loteTextoTerminado(base, sizeof(Cliente), offsetof(Cliente, cpf), sizeof(lote[0].cpf), total, falhas);
+        loteTextoTerminado(base, sizeof(Cliente), offsetof(Cliente, telefone), sizeof(lote[0].telefone), total, falhas);
+        loteNome(base, sizeof(Cliente), offsetof(Cliente, nome), sizeof(lote[0].nome), total, falhas);
+        loteCPF(base, sizeof(Cliente), offsetof(Cliente, cpf), total, falhas);
+        for (int i = 0; i < total; i++) {
+            if (!ativos[i]) continue;
+            if (falhas[i] == 0 && chaveCPF(lote[i].cpf, &chave)) {
+                if (indiceBuscar(cpfs, chave) == -1) {
+                    indiceInserir(cpfs, chave, inicio + i);
+                    continue;
+                }
+                falhas[i] = FALHA_DUPLICADO;
+            }
+            quarentenarRegistro(verificacao, clientes, inicio + i, &lote[i], falhas[i] != 0 ? falhas[i] : FALHA_CPF);
+        }
+    }
+}
+
+static void verificarVeiculos(VerificacaoCarga* verificacao, Vetor* veiculos, const IndiceHash* cpfs, IndiceHash* placas) {
+    static Veiculo lote[VERIFICACAO_LOTE];
+    unsigned char ativos[VERIFICACAO_LOTE];
+    unsigned short falhas[VERIFICACAO_LOTE];
+    const char* base = (const char*)lote;
+    unsigned long long dono;
+    unsigned int chave;
+    for (int inicio = 0; inicio < veiculos->total; inicio += VERIFICACAO_LOTE) {
+        int total = veiculos->total - inicio < VERIFICACAO_LOTE ? veiculos->total - inicio : VERIFICACAO_LOTE;
+        carregarLote(veiculos, inicio, total, (char*)lote, ativos, falhas);
+        loteTextoTerminado(base, sizeof(Veiculo), offsetof(Veiculo, placa), sizeof(lote[0].placa), total, falhas);
+        loteTextoTerminado(base, sizeof(Veiculo), offsetof(Veiculo, modelo), sizeof(lote[0].modelo), total, falhas);
+        loteTextoTerminado(base, sizeof(Veiculo), offsetof(Veiculo, cpf_cliente), sizeof(lote[0].cpf_cliente), total, falhas);
+        lotePlaca(base, sizeof(Veiculo), offsetof(Veiculo, placa), total, falhas);
+        loteCPF(base, sizeof(Veiculo), offsetof(Veiculo, cpf_cliente), total, falhas);
+        loteIntervalo(base, sizeof(Veiculo), offsetof(Veiculo, ano), 1900, 2026, total, falhas, FALHA_ANO);
+        for (int i = 0; i < total; i++) {
+            if (!ativos[i]) continue;
+            if (falhas[i] == 0 && chavePlaca(lote[i].placa, &chave) && chaveCPF(lote[i].cpf_cliente, &dono)) {
+                if (indiceBuscar(cpfs, dono) == -1) {
+                    falhas[i] = FALHA_REFERENCIA;
+                } else if (indiceBuscar(placas, chave) != -1) {
+                    falhas[i] = FALHA_DUPLICADO;
+                } else {
+                    indiceInserir(placas, chave, inicio + i);
+                    continue;
+                }
+            }
+            quarentenarRegistro(verificacao, veiculos, inicio + i, &lote[i], falhas[i] != 0 ? falhas[i] : FALHA_PLACA);
+        }
+    }
+}
+
+static void verificarOrdens(VerificacaoCarga* verificacao, Vetor* ordens, const IndiceHash* placas) {
+    static OrdemServico lote[VERIFICACAO_LOTE];
+    unsigned char ativos[VERIFICACAO_LOTE];
+    unsigned short falhas[VERIFICACAO_LOTE];
+    const char* base = (const char*)lote;
+    IndiceHash ids;
+    indiceIniciar(&ids, ordens->total);
+    unsigned int chave;
+    for (int inicio = 0; inicio < ordens->total; inicio += VERIFICACAO_LOTE) {
+        int total = ordens->total - inicio < VERIFICACAO_LOTE ? ordens->total - inicio : VERIFICACAO_LOTE;
+        carregarLote(ordens, inicio, total, (char*)lote, ativos, falhas);
+        loteTextoTerminado(base, sizeof(OrdemServico), offsetof(OrdemServico, placa_veiculo), sizeof(lote[0].placa_veiculo), total, falhas);
+        loteTextoTerminado(base, sizeof(OrdemServico), offsetof(OrdemServico, data_entrada), sizeof(lote[0].data_entrada), total, falhas);
+        loteTextoTerminado(base, sizeof(OrdemServico), offsetof(OrdemServico, descricao_problema), sizeof(lote[0].descricao_problema), total, falhas);
+        lotePlaca(base, sizeof(OrdemServico), offsetof(OrdemServico, placa_veiculo), total, falhas);
+        loteIntervalo(base, sizeof(OrdemServico), offsetof(OrdemServico, id), 1, 0x7FFFFFFF, total, falhas, FALHA_ID);
+        loteIntervalo(base, sizeof(OrdemServico), offsetof(OrdemServico, status), AGUARDANDO_AVALIACAO, ENTREGUE, total, falhas, FALHA_STATUS);
+        for (int i = 0; i < total; i++) {
+            if (!ativos[i]) continue;
+            if (falhas[i] == 0 && chavePlaca(lote[i].placa_veiculo, &chave)) {
+                if (indiceBuscar(placas, chave) == -1) {
+                    falhas[i] = FALHA_REFERENCIA;
+                } else if (indiceBuscar(&ids, (unsigned long long)lote[i].id) != -1) {
+                    falhas[i] = FALHA_DUPLICADO;
+                } else {
+                    indiceInserir(&ids, (unsigned long long)lote[i].id, inicio + i);
+                    continue;
+                }
+            }
+            quarentenarRegistro(verificacao, ordens, inicio + i, &lote[i], falhas[i] != 0 ? falhas[i] : FALHA_PLACA);
+        }
+    }
+    indiceLiberar(&ids);
+}
+
+// A verificacao da abertura cobre as tabelas e, depois, a reproducao do
+// diario. Com 'quarentenar' igual a 0 os problemas sao apenas relatados.
+void iniciarVerificacao(VerificacaoCarga* verificacao, int quarentenar) {
+    verificacao->quarentenar = quarentenar;
+    verificacao->relatorio = NULL;
+    verificacao->problemas = 0;
+    verificacao->quarentenados = 0;
+    const char* modo = getenv("OFICINA_VERIFICACAO");
+    if (modo != NULL && strcmp(modo, "relatar") == 0) verificacao->quarentenar = 0;
+}
+
+void verificarIntegridade(VerificacaoCarga* verificacao, Vetor* clientes, Vetor* veiculos, Vetor* ordens) {
+    IndiceHash cpfs, placas;
+    indiceIniciar(&cpfs, clientes->total);
+    indiceIniciar(&placas, veiculos->total);
+    verificarClientes(verificacao, clientes, &cpfs);
+    verificarVeiculos(verificacao, veiculos, &cpfs, &placas);
+    verificarOrdens(verificacao, ordens, &placas);
+    indiceLiberar(&cpfs);
+    indiceLiberar(&placas);
+}
+
+// Fecha o relatorio e avisa o usuario. Retorna quantos registros e operacoes
+// do diario foram retirados.
+long encerrarVerificacao(VerificacaoCarga* verificacao) {
+    if (verificacao->relatorio != NULL) {
+        fprintf(verificacao->relatorio, "----------------------------------------------\n");
+        fprintf(verificacao->relatorio, "Registros com problemas: %ld | Retirados para quarentena: %ld\n",
+                verificacao->problemas, verificacao->quarentenados);
+        fclose(verificacao->relatorio);
+        verificacao->relatorio = NULL;
+    }
+    if (verificacao->problemas > 0) {
+        printf("Aviso: %ld registro(s) com problemas encontrados na abertura", verificacao->problemas);
+        if (verificacao->quarentenados > 0) printf(" e retirados para quarentena_*.csv");
+        printf(". Detalhes em '%s'.\n", ARQUIVO_RELATORIO_INTEGRIDADE);
+        pausarSistema();
+    }
+    return verificacao->quarentenados;
+}
+
+
+// --- Estado da Oficina ---
+
+typedef struct {
+    PoolPaginas pool;
+    Vetor clientes;
+    Vetor veiculos;
+    Vetor ordens;
+    IndiceHash indiceCPF;
+    IndiceHash indicePlaca;
+    ColunasOrdens colunasOrdens;
+    MapaIdOrdem mapaOrdens;
+    IndiceMultiplo ordensPorPlaca;
+    IndiceMultiplo veiculosPorCPF;
+    ConjuntosStatus ordensPorStatus;
+    IndiceDatas ordensPorData;
+    IndiceTextual ordensPorTermo;
+    IndiceNomes clientesPorNome;
+    Diario diario;
+    Compartilhamento compartilhamento;
+} Oficina;
+
+void liberarOficina(Oficina* oficina) {
+    diarioFechar(&oficina->diario);
+    compartilhamentoFechar(&oficina->compartilhamento);
+    vetorLiberar(&oficina->clientes);
+    vetorLiberar(&oficina->veiculos);
+    vetorLiberar(&oficina->ordens);
+    indiceLiberar(&oficina->indiceCPF);
+    indiceLiberar(&oficina->indicePlaca);
+    colunasLiberar(&oficina->colunasOrdens);
+    mapaOrdensLiberar(&oficina->mapaOrdens);
+    multiLiberar(&oficina->ordensPorPlaca);
+    multiLiberar(&oficina->veiculosPorCPF);
+    conjuntosLiberar(&oficina->ordensPorStatus);
+    datasLiberar(&oficina->ordensPorData);
+    textualLiberar(&oficina->ordensPorTermo);
+    nomesLiberar(&oficina->clientesPorNome);
+    poolLiberar(&oficina->pool);
+}
+
+
+// --- Funcoes de logica e busca ---
+
+int buscarClientePorCPF(const IndiceHash* indiceCPF, const char* cpf) {
+    unsigned long long chave;
+    if (!chaveCPF(cpf, &chave)) return -1;
+    return indiceBuscar(indiceCPF, chave);
+}
+
+int buscarVeiculoPorPlaca(const IndiceHash* indicePlaca, const char* placa) {
+    unsigned int chave;
+    if (!chavePlaca(placa, &chave)) return -1;
+    return indiceBuscar(indicePlaca, chave);
+}
+
+// --- Operacoes sobre os dados ---
+
+// Aplicam uma operacao do diario na memoria, mantendo os indices em dia.
+// Retornam 0 se faltar memoria ou se o registro for invalido.
+
+int aplicarClienteSalvo(Oficina* oficina, const Cliente* cliente) {
+    unsigned long long chave;
+    if (!chaveCPF(cliente->cpf, &chave)) return 0;
+    int posicao = indiceBuscar(&oficina->indiceCPF, chave);
+    if (posicao != -1) {
+        Cliente atual;
+        vetorLer(&oficina->clientes, posicao, &atual);
+        if (strcmp(atual.nome, cliente->nome) != 0) {
+            nomesRemover(&oficina->clientesPorNome, atual.nome, posicao);
+            nomesAdicionar(&oficina->clientesPorNome, cliente->nome, posicao);
+        }
+        vetorGravar(&oficina->clientes, posicao, cliente);
+        return 1;
+    }
+    posicao = vetorInserir(&oficina->clientes, cliente);
+    if (posicao == -1) return 0;
+    indiceInserir(&oficina->indiceCPF, chave, posicao);
+    nomesAdicionar(&oficina->clientesPorNome, cliente->nome, posicao);
+    return 1;
+}
+
+int aplicarClienteRemovido(Oficina* oficina, const char* cpf) {
+    unsigned long long chave;
+    if (!chaveCPF(cpf, &chave)) return 0;
+    int posicao = indiceBuscar(&oficina->indiceCPF, chave);
+    if (posicao == -1) return 1;
+    Cliente cliente;
+    vetorLer(&oficina->clientes, posicao, &cliente);
+    if (!vetorRemover(&oficina->clientes, posicao)) return 0;
+    indiceRemover(&oficina->indiceCPF, chave);
+    nomesRemover(&oficina->clientesPorNome, cliente.nome, posicao);
+    return 1;
+}
+
+int aplicarVeiculoSalvo(Oficina* oficina, const Veiculo* veiculo) {
+    unsigned int chave;
+    unsigned long long chaveDono, chaveDonoAnterior;
+    if (!chavePlaca(veiculo->placa, &chave)) return 0;
+    int donoValido = chaveCPF(veiculo->cpf_cliente, &chaveDono);
+    int posicao = indiceBuscar(&oficina->indicePlaca, chave);
+    if (posicao != -1) {
+        Veiculo atual;
+        vetorLer(&oficina->veiculos, posicao, &atual);
+        if (strcmp(atual.cpf_cliente, veiculo->cpf_cliente) != 0) {
+            if (chaveCPF(atual.cpf_cliente, &chaveDonoAnterior)) multiRemover(&oficina->veiculosPorCPF, chaveDonoAnterior, posicao);
+            if (donoValido) multiAdicionar(&oficina->veiculosPorCPF, chaveDono, posicao);
+        }
+        vetorGravar(&oficina->veiculos, posicao, veiculo);
+        return 1;
+    }
+    posicao = vetorInserir(&oficina->veiculos, veiculo);
+    if (posicao == -1) return 0;
+    indiceInserir(&oficina->indicePlaca, chave, posicao);
+    if (donoValido) multiAdicionar(&oficina->veiculosPorCPF, chaveDono, posicao);
+    return 1;
+}
+
+int aplicarVeiculoRemovido(Oficina* oficina, const char* placa) {
+    unsigned int chave;
+    unsigned long long chaveDono;
+    if (!chavePlaca(placa, &chave)) return 0;
+    int posicao = indiceBuscar(&oficina->indicePlaca, chave);
+    if (posicao == -1) return 1;
+    Veiculo veiculo;
+    vetorLer(&oficina->veiculos, posicao, &veiculo);
+    int donoValido = chaveCPF(veiculo.cpf_cliente, &chaveDono);
+    if (!vetorRemover(&oficina->veiculos, posicao)) return 0;
+    indiceRemover(&oficina->indicePlaca, chave);
+    if (donoValido) multiRemover(&oficina->veiculosPorCPF, chaveDono, posicao);
+    return 1;
+}
+
+int aplicarOrdemSalva(Oficina* oficina, const OrdemServico* ordem) {
+    ColunasOrdens* colunas = &oficina->colunasOrdens;
+    int posicao = mapaOrdensBuscar(&oficina->mapaOrdens, ordem->id);
+    if (posicao != -1) {
+        unsigned int placaAnterior = colunas->placas[posicao];
+        int diaAnterior = colunas->dias[posicao];
+        colunasDefinir(colunas, posicao, ordem);
+        if (colunas->placas[posicao] != placaAnterior) {
+            if (placaAnterior != SEM_PLACA) multiRemover(&oficina->ordensPorPlaca, placaAnterior, posicao);
+            if (colunas->placas[posicao] != SEM_PLACA) multiAdicionar(&oficina->ordensPorPlaca, colunas->placas[posicao], posicao);
+        }
+        if (colunas->dias[posicao] != diaAnterior) {
+            datasRemover(&oficina->ordensPorData, diaAnterior, posicao);
+            datasAdicionar(&oficina->ordensPorData, colunas->dias[posicao], posicao);
+        }
+        OrdemServico atual;
+        vetorLer(&oficina->ordens, posicao, &atual);
+        if (strcmp(atual.descricao_problema, ordem->descricao_problema) != 0) {
+            textualRemover(&oficina->ordensPorTermo, atual.id, atual.descricao_problema);
+            textualAdicionar(&oficina->ordensPorTermo, ordem->id, ordem->descricao_problema);
+        }
+        vetorGravar(&oficina->ordens, posicao, ordem);
+        conjuntosColocar(&oficina->ordensPorStatus, posicao, (int)ordem->status);
+        return 1;
+    }
+    if (ordem->id <= 0) return 0;
+    posicao = vetorInserir(&oficina->ordens, ordem);
+    if (posicao == -1) return 0;
+    colunasDefinir(colunas, posicao, ordem);
+    mapaOrdensDefinir(&oficina->mapaOrdens, ordem->id, posicao);
+    if (colunas->placas[posicao] != SEM_PLACA) multiAdicionar(&oficina->ordensPorPlaca, colunas->placas[posicao], posicao);
+    conjuntosColocar(&oficina->ordensPorStatus, posicao, (int)ordem->status);
+    datasAdicionar(&oficina->ordensPorData, colunas->dias[posicao], posicao);
+    textualAdicionar(&oficina->ordensPorTermo, ordem->id, ordem->descricao_problema);
+    return 1;
+}
+
+int aplicarOperacao(Oficina* oficina, int tipo, const void* dados, int tamanho) {
+    Cliente cliente;
+    Veiculo veiculo;
+    OrdemServico ordem;
+    char chave[12];
+    switch (tipo) {
+        case DIARIO_CLIENTE_SALVO:
+            if (tamanho != (int)sizeof(Cliente)) return 0;
+            memcpy(&cliente, dados, sizeof(Cliente));
+            return aplicarClienteSalvo(oficina, &cliente);
+        case DIARIO_CLIENTE_REMOVIDO:
+            if (tamanho != 12) return 0;
+            memcpy(chave, dados, 12);
+            chave[11] = '\0';
+            return aplicarClienteRemovido(oficina, chave);
+        case DIARIO_VEICULO_SALVO:
+            if (tamanho != (int)sizeof(Veiculo)) return 0;
+            memcpy(&veiculo, dados, sizeof(Veiculo));
+            return aplicarVeiculoSalvo(oficina, &veiculo);
+        case DIARIO_VEICULO_REMOVIDO:
+            if (tamanho != 8) return 0;
+            memcpy(chave, dados, 8);
+            chave[7] = '\0';
+            return aplicarVeiculoRemovido(oficina, chave);
+        case DIARIO_ORDEM_SALVA:
+            if (tamanho != (int)sizeof(OrdemServico)) return 0;
+            memcpy(&ordem, dados, sizeof(OrdemServico));
+            return aplicarOrdemSalva(oficina, &ordem);
+        default:
+            return 0;
+    }
+}
+
+// Na reproducao do diario da abertura, cada operacao passa pelas mesmas
+// regras da verificacao das tabelas, contra o estado ja carregado. Retorna
+// os FALHA_* encontrados, ou 0 se a operacao pode ser aplicada.
+static unsigned short conferirOperacao(Oficina* oficina, int tipo, const unsigned char* carga, int tamanho) {
+    Cliente cliente;
+    Veiculo veiculo;
+    OrdemServico ordem;
+    char chave[12];
+    unsigned long long cpf;
+    unsigned int placa;
+    const ListaPosicoes* dependentes;
+    switch (tipo) {
+        case DIARIO_CLIENTE_SALVO:
+            if (tamanho != (int)sizeof(Cliente)) return FALHA_OPERACAO;
+            memcpy(&cliente, carga, sizeof(Cliente));
+            if (memchr(cliente.nome, '\0', sizeof(cliente.nome)) == NULL || memchr(cliente.cpf, '\0', sizeof(cliente.cpf)) == NULL ||
+                memchr(cliente.telefone, '\0', sizeof(cliente.telefone)) == NULL) return FALHA_TEXTO_ABERTO;
+            if (!validarCPF(cliente.cpf)) return FALHA_CPF;
+            if (!validarNome(cliente.nome)) return FALHA_NOME;
+            return 0;
+        case DIARIO_CLIENTE_REMOVIDO:
+            if (tamanho != 12) return FALHA_OPERACAO;
+            memcpy(chave, carga, 12);
+            chave[11] = '\0';
+            // Sem o cliente, os veiculos dele ficariam sem dono.
+            if (!chaveCPF(chave, &cpf)) return FALHA_CPF;
+            dependentes = multiBuscar(&oficina->veiculosPorCPF, cpf);
+            return dependentes != NULL && dependentes->total > 0 ? FALHA_REFERENCIA : 0;
+        case DIARIO_VEICULO_SALVO:
+            if (tamanho != (int)sizeof(Veiculo)) return FALHA_OPERACAO;
+            memcpy(&veiculo, carga, sizeof(Veiculo));
+            if (memchr(veiculo.placa, '\0', sizeof(veiculo.placa)) == NULL || memchr(veiculo.modelo, '\0', sizeof(veiculo.modelo)) == NULL ||
+                memchr(veiculo.cpf_cliente, '\0', sizeof(veiculo.cpf_cliente)) == NULL) return FALHA_TEXTO_ABERTO;
+            if (!validarPlaca(veiculo.placa)) return FALHA_PLACA;
+            if (!validarCPF(veiculo.cpf_cliente)) return FALHA_CPF;
+            if (veiculo.ano < 1900 || veiculo.ano > 2026) return FALHA_ANO;
+            if (!chaveCPF(veiculo.cpf_cliente, &cpf) || indiceBuscar(&oficina->indiceCPF, cpf) == -1) return FALHA_REFERENCIA;
+            return 0;
+        case DIARIO_VEICULO_REMOVIDO:
+            if (tamanho != 8) return FALHA_OPERACAO;
+            memcpy(chave, carga, 8);
+            chave[7] = '\0';
+            // Sem o veiculo, as ordens dele ficariam sem veiculo.
+            if (!chavePlaca(chave, &placa)) return FALHA_PLACA;
+            dependentes = multiBuscar(&oficina->ordensPorPlaca, placa);
+            return dependentes != NULL && dependentes->total > 0 ? FALHA_REFERENCIA : 0;
+        case DIARIO_ORDEM_SALVA:
+            if (tamanho != (int)sizeof(OrdemServico)) return FALHA_OPERACAO;
+            memcpy(&ordem, carga, sizeof(OrdemServico));
+            if (memchr(ordem.placa_veiculo, '\0', sizeof(ordem.placa_veiculo)) == NULL ||
+                memchr(ordem.data_entrada, '\0', sizeof(ordem.data_entrada)) == NULL ||
+                memchr(ordem.descricao_problema, '\0', sizeof(ordem.descricao_problema)) == NULL) return FALHA_TEXTO_ABERTO;
+            if (ordem.id < 1) return FALHA_ID;
+            if (!validarPlaca(ordem.placa_veiculo)) return FALHA_PLACA;
+            if (ordem.status < AGUARDANDO_AVALIACAO || ordem.status > ENTREGUE) return FALHA_STATUS;
+            if (!chavePlaca(ordem.placa_veiculo, &placa) || indiceBuscar(&oficina->indicePlaca, placa) == -1) return FALHA_REFERENCIA;
+            return 0;
+        default:
+            return FALHA_OPERACAO;
+    }
+}
+
+// --- Alteracoes entre Instancias ---
+
+// Aplica os registros do diario a partir da posicao atual de 'arquivo' ate
+// 'fim' (ou ate o final, se 'fim' for -1). Para no primeiro registro
+// incompleto ou com CRC invalido e retorna a posicao ate onde leu. Com
+// 'verificacao', cada operacao e conferida antes (reproducao na abertura); as
+// reprovadas e as que nao puderem ser aplicadas sao relatadas e puladas.
+static long aplicarTrechoDiario(Oficina* oficina, FILE* arquivo, long fim, VerificacaoCarga* verificacao) {
+    CabecalhoDiario cabecalho;
+    unsigned char carga[DIARIO_CARGA_MAXIMA];
+    long aplicado = ftell(arquivo);
+    while ((fim < 0 || aplicado < fim) && fread(&cabecalho, sizeof(cabecalho), 1, arquivo) == 1) {
+        if (cabecalho.tamanho < 0 || cabecalho.tamanho > DIARIO_CARGA_MAXIMA) break;
+        if (fread(carga, 1, (size_t)cabecalho.tamanho, arquivo) != (size_t)cabecalho.tamanho) break;
+        if (crcRegistroDiario(cabecalho.tipo, cabecalho.tamanho, carga) != cabecalho.crc) break;
+        unsigned short falhas = verificacao != NULL ? conferirOperacao(oficina, cabecalho.tipo, carga, cabecalho.tamanho) : 0;
+        if (falhas != 0) quarentenarOperacao(verificacao, aplicado, cabecalho.tipo, carga, cabecalho.tamanho, falhas);
+        if ((falhas == 0 || !verificacao->quarentenar) && !aplicarOperacao(oficina, cabecalho.tipo, carga, cabecalho.tamanho)) {
+            if (verificacao != NULL) quarentenarOperacao(verificacao, aplicado, cabecalho.tipo, carga, cabecalho.tamanho, FALHA_OPERACAO);
+            else printf("AVISO: Uma alteracao do diario nao pode ser aplicada e foi ignorada.\n");
+        }
+        aplicado = ftell(arquivo);
+    }
+    return aplicado;
+}
+
+// Traz para a memoria o que as outras instancias anexaram ao diario.
+static void alcancarDiario(Oficina* oficina) {
+    Compartilhamento* compartilhamento = &oficina->compartilhamento;
+    long fim = compartilhamento->area->tamanhoDiario;
+    if (compartilhamento->diarioAplicado < 0 || compartilhamento->diarioAplicado == fim) return;
+    FILE* arquivo = fopen(ARQUIVO_DIARIO, "rb");
+    long aplicado = -1;
+    if (arquivo != NULL && fseek(arquivo, compartilhamento->diarioAplicado, SEEK_SET) == 0) {
+        aplicado = aplicarTrechoDiario(oficina, arquivo, fim, NULL);
+    }
+    if (arquivo != NULL) fclose(arquivo);
+    if (aplicado != fim) {
+        printf("AVISO: Parte das alteracoes de outra instancia nao pode ser lida do diario.\n");
+    }
+    compartilhamento->diarioAplicado = fim;
+    oficina->diario.tamanho = fim;
+    memcpy(compartilhamento->versoes, compartilhamento->area->versoes, sizeof(compartilhamento->versoes));
+}
+
+// Toda alteracao fica entre iniciarAlteracao e concluirAlteracao; as duas
+// podem ser aninhadas (so a mais externa obtem e libera a trava).
+void iniciarAlteracao(Oficina* oficina) {
+    Compartilhamento* compartilhamento = &oficina->compartilhamento;
+    if (compartilhamento->area == NULL || compartilhamento->profundidade++ > 0) return;
+    compartilhamentoTravar(compartilhamento);
+    alcancarDiario(oficina);
+}
+
+// Publica o que foi anexado ao diario e libera a trava. Devolve 'resultado',
+// para poder ser usada direto no return das operacoes.
+int concluirAlteracao(Oficina* oficina, int resultado) {
+    Compartilhamento* compartilhamento = &oficina->compartilhamento;
+    if (compartilhamento->area == NULL || --compartilhamento->profundidade > 0) return resultado;
+    if (oficina->diario.arquivo != NULL) fflush(oficina->diario.arquivo);
+    AreaCompartilhada* area = compartilhamento->area;
+    area->tamanhoDiario = oficina->diario.tamanho;
+    for (int t = 0; t < TABELA_ORDENS; t++) {
+        if (compartilhamento->alteradas & (1 << t)) area->versoes[t]++;
+    }
+    compartilhamento->alteradas = 0;
+    compartilhamento->diarioAplicado = area->tamanhoDiario;
+    memcpy(compartilhamento->versoes, area->versoes, sizeof(compartilhamento->versoes));
+    compartilhamentoDestravar(compartilhamento);
+    return resultado;
+}
+
+// Sem trava: so compara os contadores de versao com os da ultima sincronizacao.
+int oficinaDesatualizada(const Oficina* oficina) {
+    const Compartilhamento* compartilhamento = &oficina->compartilhamento;
+    if (compartilhamento->area == NULL) return 0;
+    return memcmp(compartilhamento->versoes, compartilhamento->area->versoes, sizeof(compartilhamento->versoes)) != 0;
+}
+
+// Chamada antes de exibir dados, para mostrar tambem o que as outras
+// instancias alteraram.
+void sincronizarOficina(Oficina* oficina) {
+    if (!oficinaDesatualizada(oficina)) return;
+    iniciarAlteracao(oficina);
+    concluirAlteracao(oficina, 0);
+}
+
+// Registra a operacao no diario e a aplica. O registro so fica duravel na
+// proxima chamada a confirmarOperacoes.
+int registrarOperacao(Oficina* oficina, int tipo, const void* dados, int tamanho) {
+    if (!diarioRegistrar(&oficina->diario, tipo, dados, tamanho)) {
+        printf("AVISO: Falha ao gravar o diario. A alteracao so sera salva ao sair.\n");
+    }
+    TipoTabela tabela = tipo <= DIARIO_CLIENTE_REMOVIDO ? TABELA_CLIENTES : tipo <= DIARIO_VEICULO_REMOVIDO ? TABELA_VEICULOS : TABELA_ORDENS;
+    oficina->compartilhamento.alteradas |= 1 << (tabela - 1);
+    return aplicarOperacao(oficina, tipo, dados, tamanho);
+}
+
+// Regrava os .dat e esvazia o diario. So pode ser chamada com a trava das
+// instancias obtida e sem nenhuma outra instancia ja carregada.
+static int gravarOficina(Oficina* oficina) {
+    if (!salvarClientes(&oficina->clientes)) return 0;
+    if (!salvarVeiculos(&oficina->veiculos)) return 0;
+    if (!salvarOrdens(&oficina->ordens, proximoIdOrdem(&oficina->mapaOrdens))) return 0;
+    // Um indice desatualizado nunca pode ficar para tras: sem ele, sera refeito.
+    if (!salvarIndiceTextual(&oficina->ordensPorTermo, oficina->ordens.vivos, oficina->mapaOrdens.maiorId)) {
+        remove(ARQUIVO_INDICE_TEXTUAL);
+    }
+    diarioEsvaziar(&oficina->diario);
+    return 1;
+}
+
+// Grava o estado completo nos .dat e esvazia o diario. Com outras instancias
+// abertas na pasta, apenas confirma o diario: os .dat delas continuam em uso e
+// a ultima a sair grava tudo.
+int checkpointOficina(Oficina* oficina) {
+    iniciarAlteracao(oficina);
+    diarioConfirmar(&oficina->diario);
+    if (compartilhamentoOutras(&oficina->compartilhamento) > 0) return concluirAlteracao(oficina, 1);
+    return concluirAlteracao(oficina, gravarOficina(oficina));
+}
+
+void confirmarOperacoes(Oficina* oficina) {
+    if (!diarioConfirmar(&oficina->diario)) {
+        printf("AVISO: Falha ao sincronizar o diario com o disco.\n");
+    }
+    if (oficina->diario.tamanho > DIARIO_LIMITE_CHECKPOINT) checkpointOficina(oficina);
+}
+
+// Reaplica o diario sobre os dados carregados, conferindo cada operacao. Para
+// no primeiro registro incompleto ou com CRC invalido (gravacao interrompida
+// por uma queda). Retorna 1 se o diario inteiro foi lido.
+int reproduzirDiario(Oficina* oficina, VerificacaoCarga* verificacao) {
+    FILE* arquivo = fopen(ARQUIVO_DIARIO, "rb");
+    if (arquivo == NULL) return 1;
+    long aplicado = aplicarTrechoDiario(oficina, arquivo, -1, verificacao);
+    fseek(arquivo, 0, SEEK_END);
+    int completo = ftell(arquivo) == aplicado;
+    fclose(arquivo);
+    return completo;
+}
+
+// A abertura carrega as tres tabelas em paralelo e, depois da verificacao
+// (que precisa das tres, pois confere as referencias entre elas), monta os
+// indices de cada tabela tambem em paralelo. Cada thread so mexe nos indices
+// da sua tabela; o pool de paginas, compartilhado, tem trava propria.
+typedef struct {
+    Oficina* oficina;
+    const char* arquivo;
+    Vetor* vetor;
+    int formato;
+    int proximoId;
+} TabelaAbertura;
+
+static ROTINA_THREAD carregarTabela(void* argumento) {
+    TabelaAbertura* tabela = argumento;
+    tabela->formato = carregarDados(tabela->arquivo, tabela->vetor, &tabela->proximoId);
+    return 0;
+}
+
+static ROTINA_THREAD indexarClientes(void* argumento) {
+    Oficina* oficina = ((TabelaAbertura*)argumento)->oficina;
+    construirIndiceCPF(&oficina->indiceCPF, &oficina->clientes);
+    construirIndiceNomes(&oficina->clientesPorNome, &oficina->clientes);
+    return 0;
+}
+
+static ROTINA_THREAD indexarVeiculos(void* argumento) {
+    Oficina* oficina = ((TabelaAbertura*)argumento)->oficina;
+    construirIndicePlaca(&oficina->indicePlaca, &oficina->veiculos);
+    construirVeiculosPorCPF(&oficina->veiculosPorCPF, &oficina->veiculos);
+    return 0;
+}
+
+static ROTINA_THREAD indexarOrdens(void* argumento) {
+    TabelaAbertura* tabela = argumento;
+    Oficina* oficina = tabela->oficina;
+    construirColunasOrdens(&oficina->colunasOrdens, &oficina->ordens);
+    construirMapaOrdens(&oficina->mapaOrdens, &oficina->colunasOrdens);
+    // IDs nunca sao reaproveitados, mesmo que as ordens mais recentes faltem.
+    if (tabela->proximoId - 1 > oficina->mapaOrdens.maiorId) oficina->mapaOrdens.maiorId = tabela->proximoId - 1;
+    construirOrdensPorPlaca(&oficina->ordensPorPlaca, &oficina->colunasOrdens);
+    construirConjuntosStatus(&oficina->ordensPorStatus, &oficina->colunasOrdens);
+    construirIndiceDatas(&oficina->ordensPorData, &oficina->colunasOrdens);
+    // O indice de busca e gravado junto com ordens.dat; so e refeito se faltar,
+    // estiver corrompido ou nao corresponder as ordens carregadas.
+    if (!carregarIndiceTextual(&oficina->ordensPorTermo, oficina->ordens.vivos, oficina->mapaOrdens.maiorId)) {
+        construirIndiceTextual(&oficina->ordensPorTermo, &oficina->ordens);
+        salvarIndiceTextual(&oficina->ordensPorTermo, oficina->ordens.vivos, oficina->mapaOrdens.maiorId);
+    }
+    return 0;
+}
+
+void carregarOficina(Oficina* oficina) {
+    // Os dados sao lidos com a trava das instancias obtida, para nao pegar
+    // os arquivos no meio de um checkpoint de outra instancia.
+    compartilhamentoAbrir(&oficina->compartilhamento);
+    iniciarAlteracao(oficina);
+    if (compartilhamentoOutras(&oficina->compartilhamento) > 0) {
+        compartilhamentoCortarDiario(&oficina->compartilhamento);
+    }
+    poolIniciar(&oficina->pool);
+    vetorIniciar(&oficina->clientes, sizeof(Cliente), TABELA_CLIENTES, &oficina->pool);
+    vetorIniciar(&oficina->veiculos, sizeof(Veiculo), TABELA_VEICULOS, &oficina->pool);
+    vetorIniciar(&oficina->ordens, sizeof(OrdemServico), TABELA_ORDENS, &oficina->pool);
+
+    // A maior tabela (ordens) fica por ultimo, na thread principal.
+    TabelaAbertura tabelas[3] = {
+        { oficina, "clientes.dat", &oficina->clientes, 0, 0 },
+        { oficina, "veiculos.dat", &oficina->veiculos, 0, 0 },
+        { oficina, "ordens.dat", &oficina->ordens, 0, 0 }
+    };
+    void* argumentos[3] = { &tabelas[0], &tabelas[1], &tabelas[2] };
+    RotinaThread carregar[3] = { carregarTabela, carregarTabela, carregarTabela };
+    RotinaThread indexar[3] = { indexarClientes, indexarVeiculos, indexarOrdens };
+
+    // A tabela do CRC e montada no primeiro uso; monta antes das threads.
+    calcularCRC32(0, NULL, 0);
+    travaIniciar(&travaAvisos);
+    executarEmParalelo(carregar, argumentos, 3);
+    travaDestruir(&travaAvisos);
+    int formatoAntigo = tabelas[0].formato == 1 || tabelas[1].formato == 1 || tabelas[2].formato == 1;
+
+    // Registros retirados na verificacao so saem dos arquivos quando os .dat
+    // sao regravados, o que so e possivel sem outras instancias abertas.
+    int exclusiva = compartilhamentoOutras(&oficina->compartilhamento) == 0;
+    VerificacaoCarga verificacao;
+    iniciarVerificacao(&verificacao, exclusiva);
+    verificarIntegridade(&verificacao, &oficina->clientes, &oficina->veiculos, &oficina->ordens);
+    executarEmParalelo(indexar, argumentos, 3);
+
+    // Operacoes retiradas do diario tambem exigem regravar os .dat, para que
+    // nao sejam reproduzidas (e quarentenadas) de novo na proxima abertura.
+    int diarioIntegro = reproduzirDiario(oficina, &verificacao);
+    int quarentena = encerrarVerificacao(&verificacao) > 0;
+    diarioAbrir(&oficina->diario);
+    Compartilhamento* compartilhamento = &oficina->compartilhamento;
+    compartilhamento->diarioAplicado = oficina->diario.tamanho;
+    if (compartilhamento->area != NULL) compartilhamento->area->tamanhoDiario = oficina->diario.tamanho;
+    // Aberta sem outras instancias, esta regrava os .dat mesmo que outra tenha
+    // sido aberta durante a carga: ela ainda espera a trava e nao leu os
+    // arquivos. Caso contrario, a conversao fica para a ultima a sair.
+    int gravado = exclusiva && (quarentena || formatoAntigo || !diarioIntegro) && gravarOficina(oficina);
+    if (!diarioIntegro) {
+        printf("Aviso: Final do diario '%s' incompleto; registros aproveitaveis foram aplicados.\n", ARQUIVO_DIARIO);
+        if (!gravado) checkpointOficina(oficina);
+        pausarSistema();
+    } else if (formatoAntigo && gravado) {
+        printf("Arquivos de dados convertidos para o formato %d.\n", FORMATO_VERSAO);
+        pausarSistema();
+    }
+    concluirAlteracao(oficina, 0);
+}
+
+// --- Operacoes do sistema ---
+
+// Regras de negocio de cada operacao, sem nenhuma interacao com o usuario.
+// Sao usadas tanto pelos menus quanto pelo modo de linha de comando. Cada
+// operacao bem-sucedida e registrada no diario; quem chama decide quando
+// confirmar (confirmarOperacoes), o que permite agrupar varias de uma vez.
+typedef enum {
+    OP_OK,
+    OP_SEM_MEMORIA,
+    OP_NOME_INVALIDO,
+    OP_CPF_INVALIDO,
+    OP_CPF_DUPLICADO,
+    OP_TELEFONE_INVALIDO,
+    OP_CLIENTE_NAO_ENCONTRADO,
+    OP_CLIENTE_COM_VEICULOS,
+    OP_PLACA_INVALIDA,
+    OP_PLACA_DUPLICADA,
+    OP_MODELO_INVALIDO,
+    OP_ANO_INVALIDO,
+    OP_VEICULO_NAO_ENCONTRADO,
+    OP_VEICULO_COM_ORDENS,
+    OP_DATA_INVALIDA,
+    OP_DESCRICAO_INVALIDA,
+    OP_ORDEM_NAO_ENCONTRADA,
+    OP_STATUS_INVALIDO,
+    OP_ERRO_ARQUIVO
+} ResultadoOperacao;
+
+const char* mensagemResultado(ResultadoOperacao resultado) {
+    switch (resultado) {
+        case OP_OK: return "Operacao realizada com sucesso.";
+        case OP_SEM_MEMORIA: return "ERRO CRITICO: Falha ao alocar memoria!";
+        case OP_NOME_INVALIDO: return "ERRO: Nome deve conter apenas letras e espacos (maximo de 99 caracteres).";
+        case OP_CPF_INVALIDO: return "ERRO: Formato de CPF invalido. Deve ter 11 digitos.";
+        case OP_CPF_DUPLICADO: return "ERRO: CPF ja cadastrado.";
+        case OP_TELEFONE_INVALIDO: return "ERRO: Telefone muito longo. Maximo de 14 caracteres.";
+        case OP_CLIENTE_NAO_ENCONTRADO: return "ERRO: Cliente nao encontrado.";
+        case OP_CLIENTE_COM_VEICULOS: return "ERRO: Nao e possivel remover cliente com veiculo cadastrado.";
+        case OP_PLACA_INVALIDA: return "ERRO: Formato de placa invalido.";
+        case OP_PLACA_DUPLICADA: return "ERRO: Placa ja cadastrada.";
+        case OP_MODELO_INVALIDO: return "ERRO: Modelo nao pode ser vazio (maximo de 49 caracteres).";
+        case OP_ANO_INVALIDO: return "ERRO: Ano invalido (use 1900-2026).";
+        case OP_VEICULO_NAO_ENCONTRADO: return "ERRO: Veiculo nao encontrado.";
+        case OP_VEICULO_COM_ORDENS: return "ERRO: Nao e possivel remover veiculo com ordem de servico associada.";
+        case OP_DATA_INVALIDA: return "ERRO: Data invalida. Use DD/MM/AAAA.";
+        case OP_DESCRICAO_INVALIDA: return "ERRO: Descricao muito longa. Maximo de 199 caracteres.";
+        case OP_ORDEM_NAO_ENCONTRADA: return "ERRO: Ordem de Servico nao encontrada.";
+        case OP_STATUS_INVALIDO: return "ERRO: Opcao de status invalida.";
+        case OP_ERRO_ARQUIVO: return "ERRO: Falha ao criar arquivo de relatorio.";
+        default: return "ERRO: Operacao desconhecida.";
+    }
+}
+
+const char* getStatusString(StatusOrdem status) {
+    switch (status) {
+        case AGUARDANDO_AVALIACAO: return "Aguardando Avaliacao";
+        case EM_REPARO: return "Em Reparo";
+        case FINALIZADO: return "Finalizado";
+        case ENTREGUE: return "Entregue";
+        default: return "Desconhecido";
+    }
+}
+
+ResultadoOperacao incluirCliente(Oficina* oficina, const Cliente* cliente) {
+    iniciarAlteracao(oficina);
+    if (!validarNome(cliente->nome)) return concluirAlteracao(oficina, OP_NOME_INVALIDO);
+    if (!validarCPF(cliente->cpf)) return concluirAlteracao(oficina, OP_CPF_INVALIDO);
+    if (buscarClientePorCPF(&oficina->indiceCPF, cliente->cpf) != -1) return concluirAlteracao(oficina, OP_CPF_DUPLICADO);
+    // O registro vai byte a byte para o diario; nada alem dos textos pode ir junto.
+    Cliente novoCliente;
+    memset(&novoCliente, 0, sizeof(Cliente));
+    strcpy(novoCliente.nome, cliente->nome);
+    strcpy(novoCliente.cpf, cliente->cpf);
+    strcpy(novoCliente.telefone, cliente->telefone);
+    if (!registrarOperacao(oficina, DIARIO_CLIENTE_SALVO, &novoCliente, sizeof(Cliente))) return concluirAlteracao(oficina, OP_SEM_MEMORIA);
+    return concluirAlteracao(oficina, OP_OK);
+}
+
+// 'nome' e 'telefone' vazios (ou NULL) mantem o valor atual.
+ResultadoOperacao alterarCliente(Oficina* oficina, const char* cpf, const char* nome, const char* telefone) {
+    iniciarAlteracao(oficina);
+    int index = buscarClientePorCPF(&oficina->indiceCPF, cpf);
+    if (index == -1) return concluirAlteracao(oficina, OP_CLIENTE_NAO_ENCONTRADO);
+    Cliente cliente;
+    vetorLer(&oficina->clientes, index, &cliente);
+    if (nome != NULL && nome[0] != '\0') {
+        if (strlen(nome) > 99 || !validarNome(nome)) return concluirAlteracao(oficina, OP_NOME_INVALIDO);
+        strcpy(cliente.nome, nome);
+    }
+    if (telefone != NULL && telefone[0] != '\0') {
+        if (strlen(telefone) > 14) return concluirAlteracao(oficina, OP_TELEFONE_INVALIDO);
+        strcpy(cliente.telefone, telefone);
+    }
+    if (!registrarOperacao(oficina, DIARIO_CLIENTE_SALVO, &cliente, sizeof(Cliente))) return concluirAlteracao(oficina, OP_SEM_MEMORIA);
+    return concluirAlteracao(oficina, OP_OK);
+}
+
+ResultadoOperacao excluirCliente(Oficina* oficina, const char* cpf) {
+    iniciarAlteracao(oficina);
+    unsigned long long chave;
+    if (chaveCPF(cpf, &chave) && multiContar(&oficina->veiculosPorCPF, chave) > 0) return concluirAlteracao(oficina, OP_CLIENTE_COM_VEICULOS);
+    if (buscarClientePorCPF(&oficina->indiceCPF, cpf) == -1) return concluirAlteracao(oficina, OP_CLIENTE_NAO_ENCONTRADO);
+    char chaveRegistro[12];
+    strcpy(chaveRegistro, cpf);
+    if (!registrarOperacao(oficina, DIARIO_CLIENTE_REMOVIDO, chaveRegistro, sizeof(chaveRegistro))) return concluirAlteracao(oficina, OP_SEM_MEMORIA);
+    return concluirAlteracao(oficina, OP_OK);
+}
+
+// A placa e gravada com as letras em maiusculas.
+ResultadoOperacao incluirVeiculo(Oficina* oficina, const Veiculo* veiculo) {
+    iniciarAlteracao(oficina);
+    if (buscarClientePorCPF(&oficina->indiceCPF, veiculo->cpf_cliente) == -1) return concluirAlteracao(oficina, OP_CLIENTE_NAO_ENCONTRADO);
+    if (!validarPlaca(veiculo->placa)) return concluirAlteracao(oficina, OP_PLACA_INVALIDA);
+    if (buscarVeiculoPorPlaca(&oficina->indicePlaca, veiculo->placa) != -1) return concluirAlteracao(oficina, OP_PLACA_DUPLICADA);
+    if (strlen(veiculo->modelo) == 0) return concluirAlteracao(oficina, OP_MODELO_INVALIDO);
+    if (veiculo->ano < 1900 || veiculo->ano > 2026) return concluirAlteracao(oficina, OP_ANO_INVALIDO);
+    Veiculo novoVeiculo;
+    memset(&novoVeiculo, 0, sizeof(Veiculo));
+    strcpy(novoVeiculo.placa, veiculo->placa);
+    strcpy(novoVeiculo.modelo, veiculo->modelo);
+    strcpy(novoVeiculo.cpf_cliente, veiculo->cpf_cliente);
+    novoVeiculo.ano = veiculo->ano;
+    for (int i = 0; i < 3; i++) novoVeiculo.placa[i] = (char)toupper((unsigned char)novoVeiculo.placa[i]);
+    if (!registrarOperacao(oficina, DIARIO_VEICULO_SALVO, &novoVeiculo, sizeof(Veiculo))) return concluirAlteracao(oficina, OP_SEM_MEMORIA);
+    return concluirAlteracao(oficina, OP_OK);
+}
+
+// 'modelo' vazio (ou NULL) e 'ano' 0 mantem o valor atual.
+ResultadoOperacao alterarVeiculo(Oficina* oficina, const char* placa, const char* modelo, int ano) {
+    iniciarAlteracao(oficina);
+    int index = buscarVeiculoPorPlaca(&oficina->indicePlaca, placa);
+    if (index == -1) return concluirAlteracao(oficina, OP_VEICULO_NAO_ENCONTRADO);
+    Veiculo veiculo;
+    vetorLer(&oficina->veiculos, index, &veiculo);
+    if (modelo != NULL && modelo[0] != '\0') {
+        if (strlen(modelo) > 49) return concluirAlteracao(oficina, OP_MODELO_INVALIDO);
+        strcpy(veiculo.modelo, modelo);
+    }
+    if (ano != 0) {
+        if (ano < 1900 || ano > 2026) return concluirAlteracao(oficina, OP_ANO_INVALIDO);
+        veiculo.ano = ano;
+    }
+    if (!registrarOperacao(oficina, DIARIO_VEICULO_SALVO, &veiculo, sizeof(Veiculo))) return concluirAlteracao(oficina, OP_SEM_MEMORIA);
+    return concluirAlteracao(oficina, OP_OK);
+}
+
+ResultadoOperacao excluirVeiculo(Oficina* oficina, const char* placa) {
+    iniciarAlteracao(oficina);
+    unsigned int chave;
+    if (chavePlaca(placa, &chave) && multiContar(&oficina->ordensPorPlaca, chave) > 0) return concluirAlteracao(oficina, OP_VEICULO_COM_ORDENS);
+    if (buscarVeiculoPorPlaca(&oficina->indicePlaca, placa) == -1) return concluirAlteracao(oficina, OP_VEICULO_NAO_ENCONTRADO);
+    char chaveRegistro[8];
+    strcpy(chaveRegistro, placa);
+    if (!registrarOperacao(oficina, DIARIO_VEICULO_REMOVIDO, chaveRegistro, sizeof(chaveRegistro))) return concluirAlteracao(oficina, OP_SEM_MEMORIA);
+    return concluirAlteracao(oficina, OP_OK);
+}
+
+// Abre a ordem com status 'Aguardando Avaliacao' e devolve o ID gerado.
+ResultadoOperacao incluirOrdem(Oficina* oficina, const char* placa, const char* data, const char* descricao, int* id) {
+    iniciarAlteracao(oficina);
+    int indexVeiculo = buscarVeiculoPorPlaca(&oficina->indicePlaca, placa);
+    if (indexVeiculo == -1) return concluirAlteracao(oficina, OP_VEICULO_NAO_ENCONTRADO);
+    int dia;
+    if (!converterData(data, &dia)) return concluirAlteracao(oficina, OP_DATA_INVALIDA);
+    if (strlen(descricao) > 199) return concluirAlteracao(oficina, OP_DESCRICAO_INVALIDA);
+
+    OrdemServico novaOrdem;
+    memset(&novaOrdem, 0, sizeof(OrdemServico));
+    Veiculo veiculo;
+    vetorLer(&oficina->veiculos, indexVeiculo, &veiculo);
+    novaOrdem.id = proximoIdOrdem(&oficina->mapaOrdens);
+    strcpy(novaOrdem.placa_veiculo, veiculo.placa);
+    strcpy(novaOrdem.data_entrada, data);
+    strcpy(novaOrdem.descricao_problema, descricao);
+    novaOrdem.status = AGUARDANDO_AVALIACAO;
+    if (!registrarOperacao(oficina, DIARIO_ORDEM_SALVA, &novaOrdem, sizeof(OrdemServico))) return concluirAlteracao(oficina, OP_SEM_MEMORIA);
+    *id = novaOrdem.id;
+    return concluirAlteracao(oficina, OP_OK);
+}
+
+ResultadoOperacao alterarStatusOrdem(Oficina* oficina, int id, int status) {
+    iniciarAlteracao(oficina);
+    int index = mapaOrdensBuscar(&oficina->mapaOrdens, id);
+    if (index == -1) return concluirAlteracao(oficina, OP_ORDEM_NAO_ENCONTRADA);
+    if (status < AGUARDANDO_AVALIACAO || status > ENTREGUE) return concluirAlteracao(oficina, OP_STATUS_INVALIDO);
+    OrdemServico ordem;
+    vetorLer(&oficina->ordens, index, &ordem);
+    ordem.status = (StatusOrdem)status;
+    if (!registrarOperacao(oficina, DIARIO_ORDEM_SALVA, &ordem, sizeof(OrdemServico))) return concluirAlteracao(oficina, OP_SEM_MEMORIA);
+    return concluirAlteracao(oficina, OP_OK);
+}
+
+// Um relatorio e gerado em duas etapas. A foto copia, com os dados travados,
+// os registros que ele usa (so os do veiculo ou do cliente pedido); a escrita
+// do arquivo, a parte demorada, le apenas a foto. O servidor solta a trava
+// entre as duas, e as alteracoes seguem enquanto o arquivo e gravado sem que
+// o relatorio misture dados de antes e de depois delas.
+typedef enum {
+    RELATORIO_HISTORICO,
+    RELATORIO_VEICULOS
+} TipoRelatorio;
+
+typedef struct {
+    TipoRelatorio tipo;
+    char alvo[12];      // placa ou CPF, como foi pedido
+    Cliente cliente;
+    int total;
+    void* registros;    // OrdemServico (historico) ou Veiculo (veiculos)
+} FotoRelatorio;
+
+const char* arquivoRelatorio(TipoRelatorio tipo) {
+    return tipo == RELATORIO_HISTORICO ? "relatorio_historico_veiculo.txt" : "relatorio_veiculos_cliente.txt";
+}
+
+// Acao do comando 'relatorio' (historico ou veiculos); 0 se desconhecida.
+int relatorioPorNome(const char* nome, TipoRelatorio* tipo) {
+    if (strcmp(nome, "historico") == 0) *tipo = RELATORIO_HISTORICO;
+    else if (strcmp(nome, "veiculos") == 0) *tipo = RELATORIO_VEICULOS;
+    else return 0;
+    return 1;
+}
+
+ResultadoOperacao fotografarRelatorio(Oficina* oficina, TipoRelatorio tipo, const char* alvo, FotoRelatorio* foto) {
+    memset(foto, 0, sizeof(FotoRelatorio));
+    foto->tipo = tipo;
+    const ListaPosicoes* lista;
+    Vetor* tabela;
+    if (tipo == RELATORIO_HISTORICO) {
+        if (buscarVeiculoPorPlaca(&oficina->indicePlaca, alvo) == -1) return OP_VEICULO_NAO_ENCONTRADO;
+        unsigned int chave;
+        chavePlaca(alvo, &chave);
+        lista = multiBuscar(&oficina->ordensPorPlaca, chave);
+        tabela = &oficina->ordens;
+    } else {
+        int indexCliente = buscarClientePorCPF(&oficina->indiceCPF, alvo);
+        if (indexCliente == -1) return OP_CLIENTE_NAO_ENCONTRADO;
+        vetorLer(&oficina->clientes, indexCliente, &foto->cliente);
+        unsigned long long chave;
+        chaveCPF(alvo, &chave);
+        lista = multiBuscar(&oficina->veiculosPorCPF, chave);
+        tabela = &oficina->veiculos;
+    }
+    strncpy(foto->alvo, alvo, sizeof(foto->alvo) - 1);
+    if (lista == NULL || lista->total == 0) return OP_OK;
+
+    foto->registros = malloc((size_t)lista->total * tabela->tamanhoElemento);
+    if (foto->registros == NULL) return OP_SEM_MEMORIA;
+    for (int i = 0; i < lista->total; i++) {
+        vetorLer(tabela, lista->posicoes[i], (char*)foto->registros + (size_t)i * tabela->tamanhoElemento);
+    }
+    foto->total = lista->total;
+    return OP_OK;
+}
+
+// Escreve o arquivo a partir da foto e a libera.
+ResultadoOperacao escreverRelatorio(FotoRelatorio* foto) {
+    FILE* relatorio = fopen(arquivoRelatorio(foto->tipo), "w");
+    if (relatorio == NULL) {
+        free(foto->registros);
+        return OP_ERRO_ARQUIVO;
+    }
+
+    if (foto->tipo == RELATORIO_HISTORICO) {
+        fprintf(relatorio, "Historico de Servicos do Veiculo - Placa: %s\n", foto->alvo);
+        fprintf(relatorio, "==============================================\n");
+        const OrdemServico* ordens = foto->registros;
+        for (int i = 0; i < foto->total; i++) {
+            fprintf(relatorio, "ID Ordem: %d\n", ordens[i].id);
+            fprintf(relatorio, "Data Entrada: %s\n", ordens[i].data_entrada);
+            fprintf(relatorio, "Problema: %s\n", ordens[i].descricao_problema);
+            fprintf(relatorio, "Status: %s\n", getStatusString(ordens[i].status));
+            fprintf(relatorio, "----------------------------------------------\n");
+        }
+        if (foto->total == 0) {
+            fprintf(relatorio, "Nenhuma ordem de servico encontrada para este veiculo.\n");
+        }
+    } else {
+        fprintf(relatorio, "Veiculos do Cliente: %s (CPF: %s)\n", foto->cliente.nome, foto->alvo);
+        fprintf(relatorio, "==============================================\n");
+        const Veiculo* veiculos = foto->registros;
+        for (int i = 0; i < foto->total; i++) {
+            fprintf(relatorio, "Placa: %s\n", veiculos[i].placa);
+            fprintf(relatorio, "Modelo: %s\n", veiculos[i].modelo);
+            fprintf(relatorio, "Ano: %d\n", veiculos[i].ano);
+            fprintf(relatorio, "----------------------------------------------\n");
+        }
+        if (foto->total == 0) {
+            fprintf(relatorio, "Nenhum veiculo encontrado para este cliente.\n");
+        }
+    }
+    fclose(relatorio);
+    free(foto->registros);
+    return OP_OK;
+}
+
+ResultadoOperacao gravarRelatorio(Oficina* oficina, TipoRelatorio tipo, const char* alvo) {
+    FotoRelatorio foto;
+    ResultadoOperacao resultado = fotografarRelatorio(oficina, tipo, alvo, &foto);
+    if (resultado != OP_OK) return resultado;
+    return escreverRelatorio(&foto);
+}
+
+
+// --- Consulta de Ordens ---
+
+// Consulta com filtro por status, placa e periodo, ordenada e lida em paginas.
+// A consulta guarda apenas (chave de ordenacao, posicao) de cada ordem que
+// atende ao filtro; os registros so sao lidos e formatados pagina a pagina.
+// O filtro por placa usa o indice ordensPorPlaca, um periodo varre so os dias
+// dele no indice de datas, o filtro por status percorre so a lista daquele
+// status, e sem filtros que dependam do conteudo do
+// registro a lista sai direto do mapa de IDs, sem ler nada.
+#define ORDENS_POR_PAGINA 10
+
+typedef enum {
+    ORDENAR_ID,
+    ORDENAR_ID_DESC,
+    ORDENAR_DATA,
+    ORDENAR_DATA_DESC
+} OrdenacaoOrdens;
+
+typedef struct {
+    int status;
+    char placa[9];      // 7 caracteres, mais um para lerString detectar excesso
+    int dataInicial;
+    int dataFinal;
+    int somenteAbertas;
+    OrdenacaoOrdens ordenacao;
+} FiltroOrdens;
+
+typedef struct {
+    long long chave;
+    int posicao;
+} ItemConsulta;
+
+typedef struct {
+    ItemConsulta* itens;
+    int total;
+    int capacidade;
+    int pagina;
+    int porPagina;
+} CursorOrdens;
+
+// Status -1, placa vazia e datas 0 significam "qualquer". As datas sao
+// compactas (converterData); 'somenteAbertas' exclui as ordens ja entregues.
+void filtroOrdensPadrao(FiltroOrdens* filtro) {
+    filtro->status = -1;
+    filtro->placa[0] = '\0';
+    filtro->dataInicial = 0;
+    filtro->dataFinal = 0;
+    filtro->somenteAbertas = 0;
+    filtro->ordenacao = ORDENAR_ID;
+}
+
+void cursorIniciar(CursorOrdens* cursor, int porPagina) {
+    cursor->itens = NULL;
+    cursor->total = 0;
+    cursor->capacidade = 0;
+    cursor->pagina = 0;
+    cursor->porPagina = porPagina;
+}
+
+void cursorLiberar(CursorOrdens* cursor) {
+    free(cursor->itens);
+    cursorIniciar(cursor, cursor->porPagina);
+}
+
+int cursorTotalPaginas(const CursorOrdens* cursor) {
+    return (cursor->total + cursor->porPagina - 1) / cursor->porPagina;
+}
+
+static int cursorAdicionar(CursorOrdens* cursor, long long chave, int posicao) {
+    if (cursor->total == cursor->capacidade) {
+        int novaCapacidade = cursor->capacidade > 0 ? cursor->capacidade * 2 : 64;
+        ItemConsulta* novos = realloc(cursor->itens, novaCapacidade * sizeof(ItemConsulta));
+        if (novos == NULL) return 0;
+        cursor->itens = novos;
+        cursor->capacidade = novaCapacidade;
+    }
+    cursor->itens[cursor->total].chave = chave;
+    cursor->itens[cursor->total].posicao = posicao;
+    cursor->total++;
+    return 1;
+}
+
+static int compararItensConsulta(const void* a, const void* b) {
+    long long x = ((const ItemConsulta*)a)->chave;
+    long long y = ((const ItemConsulta*)b)->chave;
+    return (x > y) - (x < y);
+}
+
+// Chave de ordenacao; as decrescentes sao negadas para usar a mesma comparacao.
+static long long chaveConsulta(const FiltroOrdens* filtro, int id, int data) {
+    long long chave = id;
+    if (filtro->ordenacao == ORDENAR_DATA || filtro->ordenacao == ORDENAR_DATA_DESC) {
+        chave = ((long long)data << 32) | (unsigned int)id;
+    }
+    if (filtro->ordenacao == ORDENAR_ID_DESC || filtro->ordenacao == ORDENAR_DATA_DESC) chave = -chave;
+    return chave;
+}
+
+// Confere o filtro so pelas colunas quentes, sem ler o registro.
+static int posicaoAtendeFiltro(const ColunasOrdens* colunas, int posicao, const FiltroOrdens* filtro) {
+    if (colunas->ids[posicao] == 0) return 0;
+    if (filtro->status >= 0 && colunas->status[posicao] != filtro->status) return 0;
+    if (filtro->somenteAbertas && colunas->status[posicao] == ENTREGUE) return 0;
+    int dia = colunas->dias[posicao];
+    if (filtro->dataInicial != 0 && dia < filtro->dataInicial) return 0;
+    if (filtro->dataFinal != 0 && (dia == 0 || dia > filtro->dataFinal)) return 0;
+    return 1;
+}
+
+static int adicionarSeAtende(CursorOrdens* cursor, const ColunasOrdens* colunas, int posicao, const FiltroOrdens* filtro) {
+    if (!posicaoAtendeFiltro(colunas, posicao, filtro)) return 1;
+    return cursorAdicionar(cursor, chaveConsulta(filtro, colunas->ids[posicao], colunas->dias[posicao]), posicao);
+}
+
+// Refaz a consulta e volta para a primeira pagina. Retorna 0 se faltar memoria.
+// O filtro por placa usa o indice ordensPorPlaca, um periodo varre so os dias
+// dele no indice de datas, o filtro por status percorre so a lista daquele
+// status, e sem filtros a lista sai direto do mapa de IDs. Nenhum caminho le
+// os registros: tudo vem das colunas quentes.
+int consultarOrdens(Oficina* oficina, const FiltroOrdens* filtro, CursorOrdens* cursor) {
+    cursor->total = 0;
+    cursor->pagina = 0;
+    const ColunasOrdens* colunas = &oficina->colunasOrdens;
+    int filtraColunas = filtro->status >= 0 || filtro->somenteAbertas || filtro->dataInicial != 0 || filtro->dataFinal != 0 ||
+                        filtro->ordenacao == ORDENAR_DATA || filtro->ordenacao == ORDENAR_DATA_DESC;
+
+    if (filtro->placa[0] != '\0') {
+        unsigned int chave;
+        if (!chavePlaca(filtro->placa, &chave)) return 1;
+        const ListaPosicoes* historico = multiBuscar(&oficina->ordensPorPlaca, chave);
+        for (int i = 0; historico != NULL && i < historico->total; i++) {
+            if (!adicionarSeAtende(cursor, colunas, historico->posicoes[i], filtro)) return 0;
+        }
+    } else if (!filtraColunas) {
+        const MapaIdOrdem* mapa = &oficina->mapaOrdens;
+        for (int id = 1; id <= mapa->maiorId; id++) {
+            int posicao = mapaOrdensBuscar(mapa, id);
+            if (posicao == -1) continue;
+            if (!cursorAdicionar(cursor, chaveConsulta(filtro, id, 0), posicao)) return 0;
+        }
+        // Os IDs ja sairam em ordem crescente.
+        if (filtro->ordenacao == ORDENAR_ID) return 1;
+    } else if (filtro->dataInicial != 0 || filtro->dataFinal != 0) {
+        const IndiceDatas* datas = &oficina->ordensPorData;
+        for (int d = datasPrimeiroDia(datas, filtro->dataInicial); d < datas->totalDias; d++) {
+            if (filtro->dataFinal != 0 && datas->dias[d] > filtro->dataFinal) break;
+            const ListaPosicoes* doDia = datasOrdensDoDia(datas, datas->dias[d]);
+            for (int i = 0; doDia != NULL && i < doDia->total; i++) {
+                if (!adicionarSeAtende(cursor, colunas, doDia->posicoes[i], filtro)) return 0;
+            }
+        }
+    } else if (filtro->status >= 0 && filtro->status < TOTAL_STATUS) {
+        const ConjuntosStatus* conjuntos = &oficina->ordensPorStatus;
+        for (int p = conjuntosPrimeiro(conjuntos, filtro->status); p != -1; p = conjuntosProximo(conjuntos, p)) {
+            if (!adicionarSeAtende(cursor, colunas, p, filtro)) return 0;
+        }
+    } else {
+        for (int i = 0; i < colunas->total; i++) {
+            if (!adicionarSeAtende(cursor, colunas, i, filtro)) return 0;
+        }
+    }
+    qsort(cursor->itens, (size_t)cursor->total, sizeof(ItemConsulta), compararItensConsulta);
+    return 1;
+}
+
+// Ordens cuja descricao contem todas as palavras de 'texto', em ordem de ID.
+// Retorna 0 se faltar memoria.
+int consultarOrdensPorTexto(Oficina* oficina, const char* texto, CursorOrdens* cursor) {
+    cursor->total = 0;
+    cursor->pagina = 0;
+    ListaPosicoes ids = { NULL, 0, 0 };
+    if (textualConsultar(&oficina->ordensPorTermo, texto, &ids) == -1) return 0;
+    for (int i = 0; i < ids.total; i++) {
+        int posicao = mapaOrdensBuscar(&oficina->mapaOrdens, ids.posicoes[i]);
+        if (posicao == -1) continue;
+        if (!cursorAdicionar(cursor, ids.posicoes[i], posicao)) {
+            free(ids.posicoes);
+            return 0;
+        }
+    }
+    free(ids.posicoes);
+    return 1;
+}
+
+// Intervalo [inicio, fim) de itens da pagina atual.
+void cursorIntervaloPagina(const CursorOrdens* cursor, int* inicio, int* fim) {
+    *inicio = cursor->pagina * cursor->porPagina;
+    *fim = *inicio + cursor->porPagina;
+    if (*fim > cursor->total) *fim = cursor->total;
+}
+
+
+// --- Funcoes de gerenciamento do Clientes ---
+
+void cadastrarCliente(Oficina* oficina) {
+    limparTela();
+    printf("--- Cadastro de Cliente ---\n");
+    Cliente novoCliente;
+    int overflow; 
+    
+    do {
+        printf("Nome: ");
+        if (!lerString(novoCliente.nome, 101)) {
+            printf("ERRO: Nome muito longo. Maximo de 99 caracteres.\n");
+            overflow = 1;
+        } else {
+            overflow = 0;
+        }
+        if (!overflow && strlen(novoCliente.nome) == 0) {
+            printf("ERRO: Nome nao pode ser vazio.\n");
+        } else if (!overflow && !validarNome(novoCliente.nome)) {
+            printf("ERRO: Nome deve conter apenas letras e espacos.\n");
+        }
+    } while (overflow || strlen(novoCliente.nome) == 0 || !validarNome(novoCliente.nome));
+
+    do {
+        printf("CPF (11 digitos, sem pontos): ");
+        if (!lerString(novoCliente.cpf, 13)) { 
+            printf("ERRO: CPF muito longo. Maximo de 11 caracteres.\n");
+            overflow = 1;
+        } else {
+            overflow = 0;
+        }
+        
+        if (!overflow && !validarCPF(novoCliente.cpf)) {
+            printf("ERRO: Formato de CPF invalido. Deve ter 11 digitos.\n");
+        } else if (!overflow && buscarClientePorCPF(&oficina->indiceCPF, novoCliente.cpf) != -1) {
+            printf("ERRO: CPF ja cadastrado.\n");
+            novoCliente.cpf[0] = '\0';
+        }
+    } while (overflow || !validarCPF(novoCliente.cpf));
+    
+    do {
+        printf("Telefone: ");
+        if (!lerString(novoCliente.telefone, 16)) {
+            printf("ERRO: Telefone muito longo. Maximo de 14 caracteres.\n");
+            overflow = 1;
+        } else {
+            overflow = 0;
+        }
+    } while (overflow);
+
+    ResultadoOperacao resultado = incluirCliente(oficina, &novoCliente);
+    if (resultado != OP_OK) {
+        printf("%s\n", mensagemResultado(resultado));
+        pausarSistema(); return;
+    }
+    confirmarOperacoes(oficina);
+
+    printf("\nCliente cadastrado com sucesso!\n");
+    pausarSistema();
+}
+
+void atualizarCliente(Oficina* oficina) {
+    limparTela();
+    printf("--- Atualizacao de Cliente ---\n");
+    if (oficina->clientes.vivos == 0) {
+        printf("Nenhum cliente cadastrado.\n");
+        pausarSistema(); return;
+    }
+    char cpf[12];
+    int overflow;
+    do {
+        printf("Digite o CPF do cliente a ser atualizado: ");
+        if (!lerString(cpf, 13)) {
+             printf("ERRO: Formato de CPF invalido. Maximo de 11 caracteres.\n");
+             overflow = 1;
+        } else {
+            overflow = 0;
+        }
+    } while (overflow);
+
+    int index = buscarClientePorCPF(&oficina->indiceCPF, cpf);
+    if (index == -1) {
+        printf("Cliente nao encontrado.\n");
+        pausarSistema(); return;
+    }
+    Cliente cliente;
+    vetorLer(&oficina->clientes, index, &cliente);
+
+    printf("Digite os novos dados (deixe em branco para manter o atual):\n");
+    char buffer[100];
+
+    do {
+        printf("Nome atual: %s\nNovo nome: ", cliente.nome);
+        if (!lerString(buffer, 101)) {
+            printf("ERRO: Nome muito longo. Maximo de 99 caracteres.\n");
+            overflow = 1;
+        } else {
+            overflow = 0;
+            if (strlen(buffer) > 0) { 
+                if (!validarNome(buffer)) {
+                    printf("ERRO: Nome deve conter apenas letras e espacos.\n");
+                    overflow = 1; 
+                } else {
+                    strcpy(cliente.nome, buffer);
+                }
+            }
+        }
+    } while (overflow);
+
+    do {
+        printf("Telefone atual: %s\nNovo telefone: ", cliente.telefone);
+        if (!lerString(buffer, 16)) {
+            printf("ERRO: Telefone muito longo. Maximo de 14 caracteres.\n");
             overflow = 1;
         } else {
             overflow = 0;
-            if (strlen(buffer) > 0) strcpy(clientes[index].telefone, buffer);
+            if (strlen(buffer) > 0) strcpy(cliente.telefone, buffer);
         }
     } while (overflow);
+
+    ResultadoOperacao resultado = alterarCliente(oficina, cpf, cliente.nome, cliente.telefone);
+    if (resultado != OP_OK) {
+        printf("%s\n", mensagemResultado(resultado));
+        pausarSistema(); return;
+    }
+    confirmarOperacoes(oficina);
     
     printf("\nCliente atualizado com sucesso!\n");
     pausarSistema();
 }
 
-void removerCliente(Cliente** clientes, int* totalClientes, Veiculo* veiculos, int totalVeiculos) {
+void removerCliente(Oficina* oficina) {
     limparTela();
     printf("--- Remocao de Cliente ---\n");
-    if (*totalClientes == 0) {
+    if (oficina->clientes.vivos == 0) {
         printf("Nenhum cliente para remover.\n");
         pausarSistema(); return;
     }
@@ -348,50 +4158,68 @@ void removerCliente(Cliente** clientes, int* totalClientes, Veiculo* veiculos, i
         }
     } while (overflow);
 
-    for (int i = 0; i < totalVeiculos; i++) {
-        if (strcmp(veiculos[i].cpf_cliente, cpf) == 0) {
-            printf("ERRO: Nao e possivel remover cliente com veiculo cadastrado.\n");
-            pausarSistema(); return;
-        }
-    }
-
-    int index = buscarClientePorCPF(*clientes, *totalClientes, cpf);
-    if (index == -1) {
-        printf("Cliente nao encontrado.\n");
+    ResultadoOperacao resultado = excluirCliente(oficina, cpf);
+    if (resultado != OP_OK) {
+        printf("%s\n", mensagemResultado(resultado));
         pausarSistema(); return;
     }
+    confirmarOperacoes(oficina);
     
-    for (int i = index; i < (*totalClientes - 1); i++) (*clientes)[i] = (*clientes)[i + 1];
-    
-    (*totalClientes)--;
-    if (*totalClientes > 0) {
-        Cliente* temp = malloc(*totalClientes * sizeof(Cliente));
-        if (temp == NULL) {
-            printf("AVISO: Falha ao diminuir memoria, pode haver espaco desperdicado.\n");
-            return;
+    printf("\nCliente removido com sucesso!\n");
+    pausarSistema();
+}
+
+#define CLIENTES_POR_BUSCA 10
+
+void buscarClientePorNome(Oficina* oficina) {
+    limparTela();
+    printf("--- Buscar Cliente por Nome ---\n");
+    char nome[101];
+    int overflow;
+    do {
+        printf("Nome ou parte do nome: ");
+        if (!lerString(nome, sizeof(nome))) {
+            printf("ERRO: Nome muito longo. Maximo de 99 caracteres.\n");
+            overflow = 1;
+        } else {
+            overflow = 0;
         }
-        for (int i = 0; i < *totalClientes; i++) temp[i] = (*clientes)[i];
-        free(*clientes);
-        *clientes = temp;
-    } else {
-        free(*clientes);
-        *clientes = NULL;
+    } while (overflow);
+
+    CandidatoNome candidatos[CLIENTES_POR_BUSCA];
+    int total = buscarClientesPorNome(&oficina->clientesPorNome, nome, candidatos, CLIENTES_POR_BUSCA);
+    if (total == -1) {
+        printf("ERRO CRITICO: Falha ao alocar memoria!\n");
+        pausarSistema(); return;
+    }
+    if (total == 0) {
+        printf("Nenhum cliente encontrado.\n");
+        pausarSistema(); return;
+    }
+    printf("\n%-11s  %-40s  %-14s  %s\n", "CPF", "Nome", "Telefone", "Veiculos");
+    for (int i = 0; i < total; i++) {
+        Cliente cliente;
+        unsigned long long chave;
+        vetorLer(&oficina->clientes, candidatos[i].posicao, &cliente);
+        int veiculos = chaveCPF(cliente.cpf, &chave) ? multiContar(&oficina->veiculosPorCPF, chave) : 0;
+        printf("%-11s  %-40.40s  %-14s  %d%s\n", cliente.cpf, cliente.nome, cliente.telefone, veiculos,
+               candidatos[i].distancia > 0 ? "  (aproximado)" : "");
     }
-    
-    printf("\nCliente removido com sucesso!\n");
     pausarSistema();
 }
 
-void gerenciarClientes(Cliente** clientes, int* totalClientes, Veiculo* veiculos, int totalVeiculos) {
+void gerenciarClientes(Oficina* oficina) {
     int opcao = -1;
     char buffer[10];
     int overflow;
     do {
+        sincronizarOficina(oficina);
         limparTela();
         printf("--- Gerenciar Clientes ---\n");
         printf("1. Cadastrar Cliente\n");
         printf("2. Atualizar Cliente\n");
         printf("3. Remover Cliente\n");
+        printf("4. Buscar Cliente por Nome\n");
         printf("0. Voltar\n");
         printf("Escolha uma opcao: ");
         
@@ -410,9 +4238,10 @@ void gerenciarClientes(Cliente** clientes, int* totalClientes, Veiculo* veiculos
         }
 
         switch (opcao) {
-            case 1: cadastrarCliente(clientes, totalClientes); break;
-            case 2: atualizarCliente(*clientes, *totalClientes); break;
-            case 3: removerCliente(clientes, totalClientes, veiculos, totalVeiculos); break;
+            case 1: cadastrarCliente(oficina); break;
+            case 2: atualizarCliente(oficina); break;
+            case 3: removerCliente(oficina); break;
+            case 4: buscarClientePorNome(oficina); break;
             case 0: break;
             default: printf("Opcao invalida!\n"); pausarSistema();
         }
@@ -421,10 +4250,10 @@ void gerenciarClientes(Cliente** clientes, int* totalClientes, Veiculo* veiculos
 
 // --- Funcoes de gerenciamenti dos Veiculos ---
 
-void cadastrarVeiculo(Veiculo** veiculos, int* totalVeiculos, Cliente* clientes, int totalClientes) {
+void cadastrarVeiculo(Oficina* oficina) {
     limparTela();
     printf("--- Cadastro de Veiculo ---\n");
-    if (totalClientes == 0) {
+    if (oficina->clientes.vivos == 0) {
         printf("Nenhum cliente cadastrado. Cadastre um cliente primeiro.\n");
         pausarSistema(); return;
     }
@@ -443,7 +4272,7 @@ void cadastrarVeiculo(Veiculo** veiculos, int* totalVeiculos, Cliente* clientes,
         }
     } while (overflow);
     
-    if (buscarClientePorCPF(clientes, totalClientes, cpf) == -1) {
+    if (buscarClientePorCPF(&oficina->indiceCPF, cpf) == -1) {
         printf("ERRO: Cliente nao encontrado.\n");
         pausarSistema(); return;
     }
@@ -459,7 +4288,7 @@ void cadastrarVeiculo(Veiculo** veiculos, int* totalVeiculos, Cliente* clientes,
         }
         if (!overflow && !validarPlaca(novoVeiculo.placa)) {
             printf("ERRO: Formato de placa invalido.\n");
-        } else if (!overflow && buscarVeiculoPorPlaca(*veiculos, *totalVeiculos, novoVeiculo.placa) != -1) {
+        } else if (!overflow && buscarVeiculoPorPlaca(&oficina->indicePlaca, novoVeiculo.placa) != -1) {
             printf("ERRO: Placa ja cadastrada.\n");
             novoVeiculo.placa[0] = '\0';
         }
@@ -494,26 +4323,21 @@ void cadastrarVeiculo(Veiculo** veiculos, int* totalVeiculos, Cliente* clientes,
     } while (overflow || novoVeiculo.ano < 1900 || novoVeiculo.ano > 2026);
     
 
-    Veiculo* temp = malloc((*totalVeiculos + 1) * sizeof(Veiculo));
-    if (temp == NULL) {
-        printf("ERRO CRITICO: Falha ao alocar memoria para novo veiculo!\n");
+    ResultadoOperacao resultado = incluirVeiculo(oficina, &novoVeiculo);
+    if (resultado != OP_OK) {
+        printf("%s\n", mensagemResultado(resultado));
         pausarSistema(); return;
     }
-
-    for (int i = 0; i < *totalVeiculos; i++) temp[i] = (*veiculos)[i];
-    temp[*totalVeiculos] = novoVeiculo;
-    if (*veiculos != NULL) free(*veiculos);
-    *veiculos = temp;
-    (*totalVeiculos)++;
+    confirmarOperacoes(oficina);
 
     printf("\nVeiculo cadastrado com sucesso!\n");
     pausarSistema();
 }
 
-void atualizarVeiculo(Veiculo* veiculos, int totalVeiculos) {
+void atualizarVeiculo(Oficina* oficina) {
     limparTela();
     printf("--- Atualizacao de Veiculo ---\n");
-    if (totalVeiculos == 0) {
+    if (oficina->veiculos.vivos == 0) {
         printf("Nenhum veiculo cadastrado.\n");
         pausarSistema(); return;
     }
@@ -529,28 +4353,30 @@ void atualizarVeiculo(Veiculo* veiculos, int totalVeiculos) {
         }
     } while (overflow);
 
-    int index = buscarVeiculoPorPlaca(veiculos, totalVeiculos, placa);
+    int index = buscarVeiculoPorPlaca(&oficina->indicePlaca, placa);
     if (index == -1) {
         printf("Veiculo nao encontrado.\n");
         pausarSistema(); return;
     }
+    Veiculo veiculo;
+    vetorLer(&oficina->veiculos, index, &veiculo);
 
     printf("Digite os novos dados (deixe em branco para manter o atual):\n");
     char buffer[51];
 
     do {
-        printf("Modelo atual: %s\nNovo modelo: ", veiculos[index].modelo);
+        printf("Modelo atual: %s\nNovo modelo: ", veiculo.modelo);
         if (!lerString(buffer, 51)) {
             printf("ERRO: Modelo muito longo. Maximo de 49 caracteres.\n");
             overflow = 1;
         } else {
             overflow = 0;
-            if (strlen(buffer) > 0) strcpy(veiculos[index].modelo, buffer);
+            if (strlen(buffer) > 0) strcpy(veiculo.modelo, buffer);
         }
     } while (overflow);
 
     do {
-        printf("Ano atual: %d\nNovo ano: ", veiculos[index].ano);
+        printf("Ano atual: %d\nNovo ano: ", veiculo.ano);
         if (!lerString(buffer, 6)) {
             printf("ERRO: Ano muito longo. Maximo de 4 digitos.\n");
             overflow = 1;
@@ -559,7 +4385,7 @@ void atualizarVeiculo(Veiculo* veiculos, int totalVeiculos) {
             if (strlen(buffer) > 0) {
                 int ano = atoi(buffer);
                 if (ano >= 1900 && ano <= 2026) {
-                    veiculos[index].ano = ano;
+                    veiculo.ano = ano;
                 } else {
                     printf("AVISO: Ano invalido, valor nao alterado.\n");
                 }
@@ -567,14 +4393,21 @@ void atualizarVeiculo(Veiculo* veiculos, int totalVeiculos) {
         }
     } while (overflow);
 
+    ResultadoOperacao resultado = alterarVeiculo(oficina, placa, veiculo.modelo, veiculo.ano);
+    if (resultado != OP_OK) {
+        printf("%s\n", mensagemResultado(resultado));
+        pausarSistema(); return;
+    }
+    confirmarOperacoes(oficina);
+
     printf("\nVeiculo atualizado com sucesso!\n");
     pausarSistema();
 }
 
-void removerVeiculo(Veiculo** veiculos, int* totalVeiculos, OrdemServico* ordens, int totalOrdens) {
+void removerVeiculo(Oficina* oficina) {
     limparTela();
     printf("--- Remocao de Veiculo ---\n");
-    if (*totalVeiculos == 0) {
+    if (oficina->veiculos.vivos == 0) {
         printf("Nenhum veiculo para remover.\n");
         pausarSistema(); return;
     }
@@ -590,45 +4423,23 @@ void removerVeiculo(Veiculo** veiculos, int* totalVeiculos, OrdemServico* ordens
         }
     } while (overflow);
     
-    for(int i = 0; i < totalOrdens; i++){
-        if(strcmp(ordens[i].placa_veiculo, placa) == 0){
-            printf("ERRO: Nao e possivel remover veiculo com ordem de servico associada.\n");
-            pausarSistema(); return;
-        }
-    }
-
-    int index = buscarVeiculoPorPlaca(*veiculos, *totalVeiculos, placa);
-    if (index == -1) {
-        printf("Veiculo nao encontrado.\n");
+    ResultadoOperacao resultado = excluirVeiculo(oficina, placa);
+    if (resultado != OP_OK) {
+        printf("%s\n", mensagemResultado(resultado));
         pausarSistema(); return;
     }
-
-    for (int i = index; i < *totalVeiculos - 1; i++) (*veiculos)[i] = (*veiculos)[i + 1];
-    
-    (*totalVeiculos)--;
-    if (*totalVeiculos > 0) {
-        Veiculo* temp = malloc(*totalVeiculos * sizeof(Veiculo));
-        if (temp == NULL) {
-            printf("AVISO: Falha ao diminuir memoria, pode haver espaco desperdicado.\n");
-            return;
-        }
-        for (int i = 0; i < *totalVeiculos; i++) temp[i] = (*veiculos)[i];
-        free(*veiculos);
-        *veiculos = temp;
-    } else {
-        free(*veiculos);
-        *veiculos = NULL;
-    }
+    confirmarOperacoes(oficina);
     
     printf("\nVeiculo removido com sucesso!\n");
     pausarSistema();
 }
 
-void gerenciarVeiculos(Veiculo** veiculos, int* totalVeiculos, Cliente* clientes, int totalClientes, OrdemServico* ordens, int totalOrdens) {
+void gerenciarVeiculos(Oficina* oficina) {
     int opcao = -1;
     char buffer[10];
     int overflow;
     do {
+        sincronizarOficina(oficina);
         limparTela();
         printf("--- Gerenciar Veiculos ---\n");
         printf("1. Cadastrar Veiculo\n");
@@ -652,9 +4463,9 @@ void gerenciarVeiculos(Veiculo** veiculos, int* totalVeiculos, Cliente* clientes
         }
 
         switch (opcao) {
-            case 1: cadastrarVeiculo(veiculos, totalVeiculos, clientes, totalClientes); break;
-            case 2: atualizarVeiculo(*veiculos, *totalVeiculos); break;
-            case 3: removerVeiculo(veiculos, totalVeiculos, ordens, totalOrdens); break;
+            case 1: cadastrarVeiculo(oficina); break;
+            case 2: atualizarVeiculo(oficina); break;
+            case 3: removerVeiculo(oficina); break;
             case 0: break;
             default: printf("Opcao invalida!\n"); pausarSistema();
         }
@@ -663,20 +4474,10 @@ void gerenciarVeiculos(Veiculo** veiculos, int* totalVeiculos, Cliente* clientes
 
 // --- Funcoes de gerenciamento de Ordens de Servico ---
 
-const char* getStatusString(StatusOrdem status) {
-    switch (status) {
-        case AGUARDANDO_AVALIACAO: return "Aguardando Avaliacao";
-        case EM_REPARO: return "Em Reparo";
-        case FINALIZADO: return "Finalizado";
-        case ENTREGUE: return "Entregue";
-        default: return "Desconhecido";
-    }
-}
-
-void abrirOrdemServico(OrdemServico** ordens, int* totalOrdens, Veiculo* veiculos, int totalVeiculos) {
+void abrirOrdemServico(Oficina* oficina) {
     limparTela();
     printf("--- Abertura de Ordem de Servico ---\n");
-    if (totalVeiculos == 0) {
+    if (oficina->veiculos.vivos == 0) {
         printf("Nenhum veiculo cadastrado. Cadastre um veiculo primeiro.\n");
         pausarSistema(); return;
     }
@@ -684,6 +4485,7 @@ void abrirOrdemServico(OrdemServico** ordens, int* totalOrdens, Veiculo* veiculo
     OrdemServico novaOrdem;
     char placa[8];
     int overflow;
+    int dia;
 
     do {
         printf("Placa do veiculo: ");
@@ -695,13 +4497,10 @@ void abrirOrdemServico(OrdemServico** ordens, int* totalOrdens, Veiculo* veiculo
         }
     } while (overflow);
     
-    if (buscarVeiculoPorPlaca(veiculos, totalVeiculos, placa) == -1) {
+    if (buscarVeiculoPorPlaca(&oficina->indicePlaca, placa) == -1) {
         printf("ERRO: Veiculo nao encontrado.\n");
         pausarSistema(); return;
     }
-    strcpy(novaOrdem.placa_veiculo, placa);
-
-    novaOrdem.id = *totalOrdens + 1;
 
     do {
         printf("Data de Entrada (DD/MM/AAAA): ");
@@ -711,6 +4510,10 @@ void abrirOrdemServico(OrdemServico** ordens, int* totalOrdens, Veiculo* veiculo
         } else {
             overflow = 0;
         }
+        if (!overflow && !converterData(novaOrdem.data_entrada, &dia)) {
+            printf("ERRO: Data invalida. Use DD/MM/AAAA.\n");
+            overflow = 1;
+        }
     } while (overflow);
 
     do {
@@ -723,27 +4526,21 @@ void abrirOrdemServico(OrdemServico** ordens, int* totalOrdens, Veiculo* veiculo
         }
     } while (overflow);
 
-    novaOrdem.status = AGUARDANDO_AVALIACAO;
-
-    OrdemServico* temp = malloc((*totalOrdens + 1) * sizeof(OrdemServico));
-    if (temp == NULL) {
-        printf("ERRO CRITICO: Falha ao alocar memoria para nova ordem!\n");
+    ResultadoOperacao resultado = incluirOrdem(oficina, placa, novaOrdem.data_entrada, novaOrdem.descricao_problema, &novaOrdem.id);
+    if (resultado != OP_OK) {
+        printf("%s\n", mensagemResultado(resultado));
         pausarSistema(); return;
     }
-    for (int i = 0; i < *totalOrdens; i++) temp[i] = (*ordens)[i];
-    temp[*totalOrdens] = novaOrdem;
-    if (*ordens != NULL) free(*ordens);
-    *ordens = temp;
-    (*totalOrdens)++;
+    confirmarOperacoes(oficina);
     
     printf("\nOrdem de servico aberta com sucesso! ID: %d\n", novaOrdem.id);
     pausarSistema();
 }
 
-void atualizarOrdemServico(OrdemServico* ordens, int totalOrdens) {
+void atualizarOrdemServico(Oficina* oficina) {
     limparTela();
     printf("--- Atualizar Status da Ordem de Servico ---\n");
-    if (totalOrdens == 0) {
+    if (oficina->ordens.vivos == 0) {
         printf("Nenhuma ordem de servico cadastrada.\n");
         pausarSistema(); return;
     }
@@ -761,19 +4558,15 @@ void atualizarOrdemServico(OrdemServico* ordens, int totalOrdens) {
     
     int id = atoi(idBuffer);
 
-    int index = -1;
-    for (int i = 0; i < totalOrdens; i++) {
-        if (ordens[i].id == id) {
-            index = i;
-            break;
-        }
-    }
+    int index = mapaOrdensBuscar(&oficina->mapaOrdens, id);
     if (index == -1) {
         printf("Ordem de Servico nao encontrada.\n");
         pausarSistema(); return;
     }
+    OrdemServico ordem;
+    vetorLer(&oficina->ordens, index, &ordem);
 
-    printf("Status atual: %s\n", getStatusString(ordens[index].status));
+    printf("Status atual: %s\n", getStatusString(ordem.status));
     printf("Selecione o novo status:\n");
     printf("0. AGUARDANDO_AVALIACAO\n1. EM_REPARO\n2. FINALIZADO\n3. ENTREGUE\n");
     
@@ -790,45 +4583,208 @@ void atualizarOrdemServico(OrdemServico* ordens, int totalOrdens) {
     
     int novoStatus = atoi(statusBuffer);
 
-    if (novoStatus >= 0 && novoStatus <= 3) {
-        ordens[index].status = (StatusOrdem)novoStatus;
+    ResultadoOperacao resultado = alterarStatusOrdem(oficina, id, novoStatus);
+    if (resultado == OP_OK) {
+        confirmarOperacoes(oficina);
         printf("Status atualizado com sucesso!\n");
     } else {
-        printf("Opcao de status invalida.\n");
+        printf("%s\n", mensagemResultado(resultado));
     }
     pausarSistema();
 }
 
-void listarOrdens(OrdemServico* ordens, int totalOrdens) {
+static void lerFiltroOrdens(FiltroOrdens* filtro) {
     limparTela();
-    printf("--- Lista de Todas as Ordens de Servico ---\n");
-    if(totalOrdens == 0){
-        printf("Nenhuma ordem de servico cadastrada.\n");
+    printf("--- Filtrar Ordens de Servico ---\n");
+    printf("Deixe em branco para nao filtrar.\n");
+    filtroOrdensPadrao(filtro);
+    char buffer[12];
+    int overflow;
+
+    do {
+        printf("Status (0 Aguardando, 1 Em Reparo, 2 Finalizado, 3 Entregue): ");
+        if (!lerString(buffer, 4)) {
+            printf("ERRO: Opcao muito longa.\n");
+            overflow = 1;
+        } else {
+            overflow = 0;
+        }
+    } while (overflow);
+    if (buffer[0] >= '0' && buffer[0] <= '3' && buffer[1] == '\0') filtro->status = buffer[0] - '0';
+
+    do {
+        printf("Placa: ");
+        if (!lerString(filtro->placa, sizeof(filtro->placa))) {
+            printf("ERRO: Placa muito longa. Maximo de 7 caracteres.\n");
+            overflow = 1;
+        } else {
+            overflow = 0;
+        }
+    } while (overflow);
+
+    for (int i = 0; i < 2; i++) {
+        int* data = i == 0 ? &filtro->dataInicial : &filtro->dataFinal;
+        do {
+            printf(i == 0 ? "Data inicial (DD/MM/AAAA): " : "Data final (DD/MM/AAAA): ");
+            if (!lerString(buffer, 12)) {
+                printf("ERRO: Data muito longa. Maximo de 10 caracteres.\n");
+                overflow = 1;
+            } else {
+                overflow = 0;
+            }
+            if (!overflow && buffer[0] != '\0' && !converterData(buffer, data)) {
+                printf("ERRO: Data invalida.\n");
+                overflow = 1;
+            }
+        } while (overflow);
+    }
+
+    do {
+        printf("Ordenar por (1 ID, 2 ID decrescente, 3 Data, 4 Data decrescente): ");
+        if (!lerString(buffer, 4)) {
+            printf("ERRO: Opcao muito longa.\n");
+            overflow = 1;
+        } else {
+            overflow = 0;
+        }
+    } while (overflow);
+    if (buffer[0] >= '1' && buffer[0] <= '4' && buffer[1] == '\0') filtro->ordenacao = (OrdenacaoOrdens)(buffer[0] - '1');
+}
+
+static void exibirFiltroOrdens(const FiltroOrdens* filtro) {
+    static const char* ordenacoes[] = { "ID", "ID decrescente", "Data", "Data decrescente" };
+    printf("Filtro: status %s | placa %s", filtro->status >= 0 ? getStatusString((StatusOrdem)filtro->status) : "qualquer",
+           filtro->placa[0] != '\0' ? filtro->placa : "qualquer");
+    if (filtro->dataInicial != 0 || filtro->dataFinal != 0) {
+        char inicio[11] = "inicio", fim[11] = "hoje";
+        if (filtro->dataInicial != 0) formatarData(filtro->dataInicial, inicio);
+        if (filtro->dataFinal != 0) formatarData(filtro->dataFinal, fim);
+        printf(" | periodo %s a %s", inicio, fim);
+    }
+    printf(" | ordem %s\n", ordenacoes[filtro->ordenacao]);
+}
+
+static void exibirPaginaOrdens(Oficina* oficina, const CursorOrdens* cursor) {
+    if (cursor->total == 0) {
+        printf("Nenhuma ordem de servico encontrada.\n");
+        return;
+    }
+    printf("%-7s %-8s %-10s  %-20s  %s\n", "ID", "Placa", "Entrada", "Status", "Problema");
+    int inicio, fim;
+    cursorIntervaloPagina(cursor, &inicio, &fim);
+    for (int i = inicio; i < fim; i++) {
+        OrdemServico ordem;
+        vetorLer(&oficina->ordens, cursor->itens[i].posicao, &ordem);
+        printf("%-7d %-8s %-10s  %-20s  %.40s\n", ordem.id, ordem.placa_veiculo, ordem.data_entrada,
+               getStatusString(ordem.status), ordem.descricao_problema);
+    }
+}
+
+void listarOrdens(Oficina* oficina) {
+    FiltroOrdens filtro;
+    filtroOrdensPadrao(&filtro);
+    CursorOrdens cursor;
+    cursorIniciar(&cursor, ORDENS_POR_PAGINA);
+    if (!consultarOrdens(oficina, &filtro, &cursor)) {
+        printf("ERRO CRITICO: Falha ao alocar memoria!\n");
         pausarSistema(); return;
     }
 
-    for (int i = 0; i < totalOrdens; i++) {
-        printf("----------------------------------------\n");
-        printf("ID: %d\n", ordens[i].id);
-        printf("Placa do Veiculo: %s\n", ordens[i].placa_veiculo);
-        printf("Data de Entrada: %s\n", ordens[i].data_entrada);
-        printf("Problema: %s\n", ordens[i].descricao_problema);
-        printf("Status: %s\n", getStatusString(ordens[i].status));
+    char buffer[10];
+    int opcao;
+    do {
+        limparTela();
+        int paginas = cursorTotalPaginas(&cursor);
+        printf("--- Ordens de Servico (pagina %d de %d, %d encontradas) ---\n",
+               paginas > 0 ? cursor.pagina + 1 : 0, paginas, cursor.total);
+        exibirFiltroOrdens(&filtro);
+        exibirPaginaOrdens(oficina, &cursor);
+        printf("\nP. Proxima pagina  A. Pagina anterior  F. Filtrar/Ordenar  0. Voltar\n");
+        printf("Escolha uma opcao: ");
+
+        if (!lerString(buffer, 4)) {
+            opcao = -1;
+            continue;
+        }
+        opcao = toupper((unsigned char)buffer[0]);
+        if (opcao == 'P' && cursor.pagina + 1 < paginas) {
+            cursor.pagina++;
+        } else if (opcao == 'A' && cursor.pagina > 0) {
+            cursor.pagina--;
+        } else if (opcao == 'F') {
+            lerFiltroOrdens(&filtro);
+            if (!consultarOrdens(oficina, &filtro, &cursor)) {
+                printf("ERRO CRITICO: Falha ao alocar memoria!\n");
+                pausarSistema();
+                opcao = '0';
+            }
+        }
+    } while (opcao != '0' && opcao != '\0');
+
+    cursorLiberar(&cursor);
+}
+
+void buscarOrdensPorDescricao(Oficina* oficina) {
+    limparTela();
+    printf("--- Buscar Ordens por Descricao ---\n");
+    char texto[201];
+    int overflow;
+    do {
+        printf("Palavras-chave (todas devem aparecer): ");
+        if (!lerString(texto, 201)) {
+            printf("ERRO: Texto muito longo. Maximo de 199 caracteres.\n");
+            overflow = 1;
+        } else {
+            overflow = 0;
+        }
+    } while (overflow);
+
+    CursorOrdens cursor;
+    cursorIniciar(&cursor, ORDENS_POR_PAGINA);
+    if (!consultarOrdensPorTexto(oficina, texto, &cursor)) {
+        printf("ERRO CRITICO: Falha ao alocar memoria!\n");
+        pausarSistema(); return;
     }
-    printf("----------------------------------------\n");
-    pausarSistema();
+
+    char buffer[10];
+    int opcao;
+    do {
+        limparTela();
+        int paginas = cursorTotalPaginas(&cursor);
+        printf("--- Busca: \"%s\" (pagina %d de %d, %d encontradas) ---\n", texto,
+               paginas > 0 ? cursor.pagina + 1 : 0, paginas, cursor.total);
+        exibirPaginaOrdens(oficina, &cursor);
+        printf("\nP. Proxima pagina  A. Pagina anterior  0. Voltar\n");
+        printf("Escolha uma opcao: ");
+
+        if (!lerString(buffer, 4)) {
+            opcao = -1;
+            continue;
+        }
+        opcao = toupper((unsigned char)buffer[0]);
+        if (opcao == 'P' && cursor.pagina + 1 < paginas) cursor.pagina++;
+        else if (opcao == 'A' && cursor.pagina > 0) cursor.pagina--;
+    } while (opcao != '0' && opcao != '\0');
+
+    cursorLiberar(&cursor);
 }
 
-void gerenciarOrdens(OrdemServico** ordens, int* totalOrdens, Veiculo* veiculos, int totalVeiculos) {
+void gerenciarOrdens(Oficina* oficina) {
     int opcao = -1;
     char buffer[10];
     int overflow;
     do {
+        sincronizarOficina(oficina);
         limparTela();
         printf("--- Gerenciar Ordens de Servico ---\n");
+        for (int s = 0; s < TOTAL_STATUS; s++) {
+            printf("%s%s: %d", s > 0 ? " | " : "", getStatusString((StatusOrdem)s), conjuntosContar(&oficina->ordensPorStatus, s));
+        }
+        printf("\n\n");
         printf("1. Abrir Ordem de Servico\n");
         printf("2. Atualizar Status da Ordem\n");
-        printf("3. Listar Todas as Ordens\n");
+        printf("3. Listar Ordens\n");
+        printf("4. Buscar por Descricao\n");
         printf("0. Voltar\n");
         printf("Escolha uma opcao: ");
         
@@ -847,9 +4803,10 @@ void gerenciarOrdens(OrdemServico** ordens, int* totalOrdens, Veiculo* veiculos,
         }
 
         switch (opcao) {
-            case 1: abrirOrdemServico(ordens, totalOrdens, veiculos, totalVeiculos); break;
-            case 2: atualizarOrdemServico(*ordens, *totalOrdens); break;
-            case 3: listarOrdens(*ordens, *totalOrdens); break;
+            case 1: abrirOrdemServico(oficina); break;
+            case 2: atualizarOrdemServico(oficina); break;
+            case 3: listarOrdens(oficina); break;
+            case 4: buscarOrdensPorDescricao(oficina); break;
             case 0: break;
             default: printf("Opcao invalida!\n"); pausarSistema();
         }
@@ -858,10 +4815,10 @@ void gerenciarOrdens(OrdemServico** ordens, int* totalOrdens, Veiculo* veiculos,
 
 // --- Funcoes de Relatorio ---
 
-void relatorioHistoricoVeiculo(Veiculo* veiculos, int totalVeiculos, OrdemServico* ordens, int totalOrdens) {
+void relatorioHistoricoVeiculo(Oficina* oficina) {
     limparTela();
     printf("--- Relatorio: Historico de Servicos por Veiculo ---\n");
-    if (totalVeiculos == 0) {
+    if (oficina->veiculos.vivos == 0) {
         printf("Nenhum veiculo cadastrado.\n");
         pausarSistema(); return;
     }
@@ -873,105 +4830,424 @@ void relatorioHistoricoVeiculo(Veiculo* veiculos, int totalVeiculos, OrdemServic
             printf("ERRO: Placa muito longa. Maximo de 7 caracteres.\n");
             overflow = 1;
         } else {
-            overflow = 0;
+            overflow = 0;
+        }
+    } while (overflow);
+    
+    ResultadoOperacao resultado = gravarRelatorio(oficina, RELATORIO_HISTORICO, placa);
+    if (resultado != OP_OK) {
+        printf("%s\n", mensagemResultado(resultado));
+        pausarSistema(); return;
+    }
+    printf("Relatorio 'relatorio_historico_veiculo.txt' gerado com sucesso!\n");
+    pausarSistema();
+}
+
+void relatorioVeiculosCliente(Oficina* oficina) {
+    limparTela();
+    printf("--- Relatorio: Veiculos por Cliente ---\n");
+    if (oficina->clientes.vivos == 0) {
+        printf("Nenhum cliente cadastrado.\n");
+        pausarSistema(); return;
+    }
+    char cpf[12];
+    int overflow;
+    do {
+        printf("Digite o CPF do cliente: ");
+        if (!lerString(cpf, 13)) {
+             printf("ERRO: Formato de CPF invalido. Maximo de 11 caracteres.\n");
+             overflow = 1;
+        } else {
+            overflow = 0;
+        }
+    } while (overflow);
+
+    ResultadoOperacao resultado = gravarRelatorio(oficina, RELATORIO_VEICULOS, cpf);
+    if (resultado != OP_OK) {
+        printf("%s\n", mensagemResultado(resultado));
+        pausarSistema(); return;
+    }
+    printf("Relatorio 'relatorio_veiculos_cliente.txt' gerado com sucesso!\n");
+    pausarSistema();
+}
+
+void gerarRelatorios(Oficina* oficina) {
+     int opcao = -1;
+     char buffer[10];
+     int overflow;
+    do {
+        sincronizarOficina(oficina);
+        limparTela();
+        printf("--- Gerar Relatorios ---\n");
+        printf("1. Historico de servicos de um veiculo\n");
+        printf("2. Listar veiculos de um cliente\n");
+        printf("0. Voltar\n");
+        printf("Escolha uma opcao: ");
+        
+        if (!lerString(buffer, 4)) {
+            printf("ERRO: Opcao muito longa.\n");
+            overflow = 1;
+            opcao = -1;
+        } else {
+            overflow = 0;
+            opcao = atoi(buffer);
+        }
+
+        if(overflow) {
+            pausarSistema();
+            continue;
+        }
+
+        switch (opcao) {
+            case 1: relatorioHistoricoVeiculo(oficina); break;
+            case 2: relatorioVeiculosCliente(oficina); break;
+            case 0: break;
+            default: printf("Opcao invalida!\n"); pausarSistema();
+        }
+    } while (opcao != 0);
+}
+
+// --- Importacao em Lote (CSV) ---
+
+// Le arquivos CSV grandes em blocos de 1 MB e processa as linhas em lotes:
+// primeiro todas as linhas do lote sao convertidas e validadas com as mesmas
+// regras do cadastro, depois as validas sao incluidas em ordem, checando
+// unicidade e chaves estrangeiras pelos indices. As inclusoes nao passam pelo
+// diario; os .dat sao regravados de uma vez no fim. Com outras instancias
+// abertas na pasta, que ainda usam os .dat, as inclusoes vao para o diario.
+#define IMPORTACAO_BLOCO (1024 * 1024)
+#define IMPORTACAO_LOTE 4096
+#define IMPORTACAO_MAX_CAMPOS 8
+#define ARQUIVO_RELATORIO_IMPORTACAO "relatorio_importacao.txt"
+
+typedef enum {
+    IMPORTAR_CLIENTES,
+    IMPORTAR_VEICULOS,
+    IMPORTAR_ORDENS
+} TipoImportacao;
+
+typedef struct {
+    FILE* arquivo;
+    char* buffer;
+    size_t capacidade;
+    size_t inicio;
+    size_t fim;
+    int fimArquivo;
+    int erro;
+} LeitorLinhas;
+
+typedef struct {
+    long numero;
+    const char* motivo;
+    union {
+        Cliente cliente;
+        Veiculo veiculo;
+        OrdemServico ordem;
+    } registro;
+} LinhaImportada;
+
+typedef struct {
+    long lidas;
+    long importadas;
+    long rejeitadas;
+    int gravado;    // 0: o que foi importado ficou apenas na memoria
+} ResumoImportacao;
+
+// Devolve a proxima linha (sem o '\n') ou NULL no fim do arquivo. O texto fica
+// no buffer do leitor e so vale ate a proxima chamada.
+char* leitorProximaLinha(LeitorLinhas* leitor) {
+    for (;;) {
+        char* inicio = leitor->buffer + leitor->inicio;
+        char* quebra = memchr(inicio, '\n', leitor->fim - leitor->inicio);
+        if (quebra != NULL) {
+            *quebra = '\0';
+            leitor->inicio = (size_t)(quebra - leitor->buffer) + 1;
+            return inicio;
+        }
+        if (leitor->fimArquivo) {
+            if (leitor->inicio == leitor->fim) return NULL;
+            leitor->buffer[leitor->fim] = '\0';
+            leitor->inicio = leitor->fim;
+            return inicio;
+        }
+
+        // Leva o pedaco de linha que sobrou para o inicio e le mais um bloco.
+        size_t restante = leitor->fim - leitor->inicio;
+        memmove(leitor->buffer, inicio, restante);
+        leitor->inicio = 0;
+        leitor->fim = restante;
+        if (leitor->fim == leitor->capacidade) {
+            char* maior = realloc(leitor->buffer, leitor->capacidade * 2 + 1);
+            if (maior == NULL) {
+                leitor->erro = 1;
+                return NULL;
+            }
+            leitor->buffer = maior;
+            leitor->capacidade *= 2;
+        }
+        size_t lidos = fread(leitor->buffer + leitor->fim, 1, leitor->capacidade - leitor->fim, leitor->arquivo);
+        leitor->fim += lidos;
+        if (lidos == 0) {
+            if (ferror(leitor->arquivo)) leitor->erro = 1;
+            leitor->fimArquivo = 1;
+        }
+    }
+}
+
+// Separa uma linha CSV em campos, no proprio buffer. Aceita campos entre
+// aspas (com "" para uma aspa literal) e o \r de arquivos do Windows.
+// Retorna o numero de campos, ou maximo + 1 se a linha tiver campos demais.
+int separarCamposCSV(char* linha, char** campos, int maximo) {
+    size_t tamanho = strlen(linha);
+    if (tamanho > 0 && linha[tamanho - 1] == '\r') linha[tamanho - 1] = '\0';
+
+    int total = 0;
+    char* leitura = linha;
+    for (;;) {
+        if (total == maximo) return maximo + 1;
+        char* escrita = leitura;
+        campos[total++] = escrita;
+        if (*leitura == '"') {
+            leitura++;
+            while (*leitura != '\0') {
+                if (*leitura == '"') {
+                    if (leitura[1] != '"') {
+                        leitura++;
+                        break;
+                    }
+                    leitura++;
+                }
+                *escrita++ = *leitura++;
+            }
+        }
+        while (*leitura != '\0' && *leitura != ',') *escrita++ = *leitura++;
+        int fimLinha = *leitura == '\0';
+        *escrita = '\0';
+        if (fimLinha) return total;
+        leitura++;
+    }
+}
+
+static int anoValido(const char* texto, int* ano) {
+    if (strlen(texto) != 4) return 0;
+    for (int i = 0; i < 4; i++) {
+        if (!isdigit((unsigned char)texto[i])) return 0;
+    }
+    *ano = atoi(texto);
+    return *ano >= 1900 && *ano <= 2026;
+}
+
+// Conversores: aplicam as regras de formato do cadastro a uma linha.
+// Retornam NULL se a linha for valida, ou o motivo da rejeicao.
+
+static const char* converterCliente(char** campos, int total, Cliente* cliente) {
+    if (total != 3) return "numero de colunas invalido (esperado: nome,cpf,telefone)";
+    if (strlen(campos[0]) > 99) return "nome muito longo";
+    if (!validarNome(campos[0])) return "nome vazio ou com caracteres invalidos";
+    if (!validarCPF(campos[1])) return "CPF invalido";
+    if (strlen(campos[2]) > 14) return "telefone muito longo";
+    strcpy(cliente->nome, campos[0]);
+    strcpy(cliente->cpf, campos[1]);
+    strcpy(cliente->telefone, campos[2]);
+    return NULL;
+}
+
+static const char* converterVeiculo(char** campos, int total, Veiculo* veiculo) {
+    if (total != 4) return "numero de colunas invalido (esperado: placa,modelo,ano,cpf_cliente)";
+    if (!validarPlaca(campos[0])) return "placa invalida";
+    if (strlen(campos[1]) == 0) return "modelo vazio";
+    if (strlen(campos[1]) > 49) return "modelo muito longo";
+    if (!anoValido(campos[2], &veiculo->ano)) return "ano invalido (use 1900-2026)";
+    if (!validarCPF(campos[3])) return "CPF do proprietario invalido";
+    strcpy(veiculo->placa, campos[0]);
+    for (int i = 0; i < 3; i++) veiculo->placa[i] = (char)toupper((unsigned char)veiculo->placa[i]);
+    strcpy(veiculo->modelo, campos[1]);
+    strcpy(veiculo->cpf_cliente, campos[3]);
+    return NULL;
+}
+
+static const char* converterOrdem(char** campos, int total, OrdemServico* ordem) {
+    if (total != 3 && total != 4) return "numero de colunas invalido (esperado: placa,data_entrada,descricao[,status])";
+    if (!validarPlaca(campos[0])) return "placa invalida";
+    int dia;
+    if (!converterData(campos[1], &dia)) return "data invalida (use DD/MM/AAAA)";
+    if (strlen(campos[2]) > 199) return "descricao muito longa";
+    ordem->status = AGUARDANDO_AVALIACAO;
+    if (total == 4 && campos[3][0] != '\0') {
+        if (strlen(campos[3]) != 1 || campos[3][0] < '0' || campos[3][0] > '3') return "status invalido (use 0-3)";
+        ordem->status = (StatusOrdem)(campos[3][0] - '0');
+    }
+    strcpy(ordem->placa_veiculo, campos[0]);
+    strcpy(ordem->data_entrada, campos[1]);
+    strcpy(ordem->descricao_problema, campos[2]);
+    return NULL;
+}
+
+static int gravarImportado(Oficina* oficina, int viaDiario, int tipo, const void* dados, int tamanho) {
+    if (viaDiario) return registrarOperacao(oficina, tipo, dados, tamanho);
+    return aplicarOperacao(oficina, tipo, dados, tamanho);
+}
+
+// Inclusao: unicidade e chaves estrangeiras contra o que ja esta nas tabelas,
+// inclusive as linhas anteriores do mesmo arquivo.
+static const char* incluirLinha(Oficina* oficina, TipoImportacao tipo, LinhaImportada* linha, int viaDiario) {
+    if (tipo == IMPORTAR_CLIENTES) {
+        Cliente* cliente = &linha->registro.cliente;
+        if (buscarClientePorCPF(&oficina->indiceCPF, cliente->cpf) != -1) return "CPF ja cadastrado";
+        if (!gravarImportado(oficina, viaDiario, DIARIO_CLIENTE_SALVO, cliente, sizeof(Cliente))) return "falta de memoria";
+    } else if (tipo == IMPORTAR_VEICULOS) {
+        Veiculo* veiculo = &linha->registro.veiculo;
+        if (buscarClientePorCPF(&oficina->indiceCPF, veiculo->cpf_cliente) == -1) return "cliente nao encontrado";
+        if (buscarVeiculoPorPlaca(&oficina->indicePlaca, veiculo->placa) != -1) return "placa ja cadastrada";
+        if (!gravarImportado(oficina, viaDiario, DIARIO_VEICULO_SALVO, veiculo, sizeof(Veiculo))) return "falta de memoria";
+    } else {
+        OrdemServico* ordem = &linha->registro.ordem;
+        int indexVeiculo = buscarVeiculoPorPlaca(&oficina->indicePlaca, ordem->placa_veiculo);
+        if (indexVeiculo == -1) return "veiculo nao encontrado";
+        Veiculo veiculo;
+        vetorLer(&oficina->veiculos, indexVeiculo, &veiculo);
+        strcpy(ordem->placa_veiculo, veiculo.placa);
+        ordem->id = proximoIdOrdem(&oficina->mapaOrdens);
+        if (!gravarImportado(oficina, viaDiario, DIARIO_ORDEM_SALVA, ordem, sizeof(OrdemServico))) return "falta de memoria";
+    }
+    return NULL;
+}
+
+static void processarLoteImportacao(Oficina* oficina, TipoImportacao tipo, LinhaImportada* lote, int total,
+                                    FILE* relatorio, ResumoImportacao* resumo, int viaDiario) {
+    for (int i = 0; i < total; i++) {
+        if (lote[i].motivo == NULL) lote[i].motivo = incluirLinha(oficina, tipo, &lote[i], viaDiario);
+        if (lote[i].motivo == NULL) {
+            resumo->importadas++;
+        } else {
+            resumo->rejeitadas++;
+            fprintf(relatorio, "Linha %ld: %s\n", lote[i].numero, lote[i].motivo);
         }
-    } while (overflow);
-    
-    if (buscarVeiculoPorPlaca(veiculos, totalVeiculos, placa) == -1) {
-        printf("Veiculo nao encontrado.\n");
-        pausarSistema(); return;
     }
+}
+
+// Importa um arquivo CSV inteiro. A primeira linha e ignorada se for um
+// cabecalho (primeira coluna "nome" ou "placa"). Retorna 0 se o arquivo ou o
+// relatorio nao puderem ser abertos.
+int importarArquivoCSV(Oficina* oficina, TipoImportacao tipo, const char* caminho, ResumoImportacao* resumo) {
+    resumo->lidas = 0;
+    resumo->importadas = 0;
+    resumo->rejeitadas = 0;
+    resumo->gravado = 1;
 
-    FILE* relatorio = fopen("relatorio_historico_veiculo.txt", "w");
+    LeitorLinhas leitor = { NULL, NULL, IMPORTACAO_BLOCO, 0, 0, 0, 0 };
+    leitor.arquivo = fopen(caminho, "rb");
+    if (leitor.arquivo == NULL) return 0;
+    FILE* relatorio = fopen(ARQUIVO_RELATORIO_IMPORTACAO, "w");
     if (relatorio == NULL) {
-        perror("Erro ao criar arquivo de relatorio");
-        pausarSistema(); return;
+        fclose(leitor.arquivo);
+        return 0;
+    }
+    leitor.buffer = malloc(leitor.capacidade + 1);
+    LinhaImportada* lote = malloc(IMPORTACAO_LOTE * sizeof(LinhaImportada));
+    if (leitor.buffer == NULL || lote == NULL) {
+        printf("ERRO CRITICO: Falha ao alocar memoria para a importacao!\n");
+        exit(EXIT_FAILURE);
     }
 
-    fprintf(relatorio, "Historico de Servicos do Veiculo - Placa: %s\n", placa);
+    fprintf(relatorio, "Relatorio de Importacao - Arquivo: %s\n", caminho);
     fprintf(relatorio, "==============================================\n");
-    int encontrou = 0;
-    for (int i = 0; i < totalOrdens; i++) {
-        if (strcmp(ordens[i].placa_veiculo, placa) == 0) {
-            fprintf(relatorio, "ID Ordem: %d\n", ordens[i].id);
-            fprintf(relatorio, "Data Entrada: %s\n", ordens[i].data_entrada);
-            fprintf(relatorio, "Problema: %s\n", ordens[i].descricao_problema);
-            fprintf(relatorio, "Status: %s\n", getStatusString(ordens[i].status));
-            fprintf(relatorio, "----------------------------------------------\n");
-            encontrou = 1;
+
+    // A trava fica obtida ate a gravacao: uma instancia aberta no meio da
+    // importacao espera, sem ler os .dat, e nao atrapalha a regravacao.
+    iniciarAlteracao(oficina);
+    int viaDiario = compartilhamentoOutras(&oficina->compartilhamento) > 0;
+
+    const char* cabecalho = tipo == IMPORTAR_CLIENTES ? "nome" : "placa";
+    char* campos[IMPORTACAO_MAX_CAMPOS];
+    int totalLote = 0;
+    long numero = 0;
+    char* texto;
+    while ((texto = leitorProximaLinha(&leitor)) != NULL) {
+        numero++;
+        int totalCampos = separarCamposCSV(texto, campos, IMPORTACAO_MAX_CAMPOS);
+        if (totalCampos == 1 && campos[0][0] == '\0') continue;
+        if (numero == 1 && strcmp(campos[0], cabecalho) == 0) continue;
+
+        LinhaImportada* linha = &lote[totalLote++];
+        linha->numero = numero;
+        // Com outras instancias abertas o registro vai byte a byte para o diario.
+        memset(&linha->registro, 0, sizeof(linha->registro));
+        if (tipo == IMPORTAR_CLIENTES) linha->motivo = converterCliente(campos, totalCampos, &linha->registro.cliente);
+        else if (tipo == IMPORTAR_VEICULOS) linha->motivo = converterVeiculo(campos, totalCampos, &linha->registro.veiculo);
+        else linha->motivo = converterOrdem(campos, totalCampos, &linha->registro.ordem);
+        resumo->lidas++;
+
+        if (totalLote == IMPORTACAO_LOTE) {
+            processarLoteImportacao(oficina, tipo, lote, totalLote, relatorio, resumo, viaDiario);
+            totalLote = 0;
         }
     }
-    if (!encontrou) {
-        fprintf(relatorio, "Nenhuma ordem de servico encontrada para este veiculo.\n");
+    processarLoteImportacao(oficina, tipo, lote, totalLote, relatorio, resumo, viaDiario);
+    if (resumo->importadas > 0) {
+        resumo->gravado = viaDiario ? diarioConfirmar(&oficina->diario) : gravarOficina(oficina);
     }
+    concluirAlteracao(oficina, 0);
+
+    if (leitor.erro) fprintf(relatorio, "ERRO: Leitura interrompida apos a linha %ld.\n", numero);
+    if (resumo->rejeitadas == 0) fprintf(relatorio, "Nenhuma linha rejeitada.\n");
+    fprintf(relatorio, "----------------------------------------------\n");
+    fprintf(relatorio, "Linhas lidas: %ld | Importadas: %ld | Rejeitadas: %ld\n",
+            resumo->lidas, resumo->importadas, resumo->rejeitadas);
+
+    free(lote);
+    free(leitor.buffer);
+    fclose(leitor.arquivo);
     fclose(relatorio);
-    printf("Relatorio 'relatorio_historico_veiculo.txt' gerado com sucesso!\n");
-    pausarSistema();
+    return 1;
 }
 
-void relatorioVeiculosCliente(Cliente* clientes, int totalClientes, Veiculo* veiculos, int totalVeiculos) {
+void importarTabela(Oficina* oficina, TipoImportacao tipo) {
     limparTela();
-    printf("--- Relatorio: Veiculos por Cliente ---\n");
-    if (totalClientes == 0) {
-        printf("Nenhum cliente cadastrado.\n");
-        pausarSistema(); return;
-    }
-    char cpf[12];
+    printf("--- Importar Dados (CSV) ---\n");
+    if (tipo == IMPORTAR_CLIENTES) printf("Colunas: nome,cpf,telefone\n");
+    else if (tipo == IMPORTAR_VEICULOS) printf("Colunas: placa,modelo,ano,cpf_cliente\n");
+    else printf("Colunas: placa,data_entrada,descricao[,status 0-3]\n");
+
+    char caminho[257];
     int overflow;
     do {
-        printf("Digite o CPF do cliente: ");
-        if (!lerString(cpf, 13)) {
-             printf("ERRO: Formato de CPF invalido. Maximo de 11 caracteres.\n");
-             overflow = 1;
+        printf("Caminho do arquivo CSV: ");
+        if (!lerString(caminho, sizeof(caminho))) {
+            printf("ERRO: Caminho muito longo. Maximo de 255 caracteres.\n");
+            overflow = 1;
         } else {
             overflow = 0;
         }
     } while (overflow);
 
-    int indexCliente = buscarClientePorCPF(clientes, totalClientes, cpf);
-    if (indexCliente == -1) {
-        printf("Cliente nao encontrado.\n");
-        pausarSistema(); return;
-    }
-
-    FILE* relatorio = fopen("relatorio_veiculos_cliente.txt", "w");
-     if (relatorio == NULL) {
-        perror("Erro ao criar arquivo de relatorio");
+    ResumoImportacao resumo;
+    if (!importarArquivoCSV(oficina, tipo, caminho, &resumo)) {
+        exibirTela();
+        perror("Erro ao abrir arquivo de importacao");
         pausarSistema(); return;
     }
-
-    fprintf(relatorio, "Veiculos do Cliente: %s (CPF: %s)\n", clientes[indexCliente].nome, cpf);
-    fprintf(relatorio, "==============================================\n");
-    int encontrou = 0;
-    for (int i = 0; i < totalVeiculos; i++) {
-        if (strcmp(veiculos[i].cpf_cliente, cpf) == 0) {
-            fprintf(relatorio, "Placa: %s\n", veiculos[i].placa);
-            fprintf(relatorio, "Modelo: %s\n", veiculos[i].modelo);
-            fprintf(relatorio, "Ano: %d\n", veiculos[i].ano);
-            fprintf(relatorio, "----------------------------------------------\n");
-            encontrou = 1;
-        }
-    }
-     if (!encontrou) {
-        fprintf(relatorio, "Nenhum veiculo encontrado para este cliente.\n");
+    if (!resumo.gravado) {
+        printf("AVISO: Dados importados ficaram apenas na memoria; serao gravados ao sair.\n");
     }
-    fclose(relatorio);
-    printf("Relatorio 'relatorio_veiculos_cliente.txt' gerado com sucesso!\n");
+    printf("Importacao concluida: %ld importadas, %ld rejeitadas.\n", resumo.importadas, resumo.rejeitadas);
+    printf("Relatorio '%s' gerado com sucesso!\n", ARQUIVO_RELATORIO_IMPORTACAO);
     pausarSistema();
 }
 
-void gerarRelatorios(Cliente* clientes, int totalClientes, Veiculo* veiculos, int totalVeiculos, OrdemServico* ordens, int totalOrdens) {
-     int opcao = -1;
-     char buffer[10];
-     int overflow;
+void importarDados(Oficina* oficina) {
+    int opcao = -1;
+    char buffer[10];
+    int overflow;
     do {
         limparTela();
-        printf("--- Gerar Relatorios ---\n");
-        printf("1. Historico de servicos de um veiculo\n");
-        printf("2. Listar veiculos de um cliente\n");
+        printf("--- Importar Dados (CSV) ---\n");
+        printf("1. Clientes\n");
+        printf("2. Veiculos\n");
+        printf("3. Ordens de Servico\n");
         printf("0. Voltar\n");
         printf("Escolha uma opcao: ");
-        
+
         if (!lerString(buffer, 4)) {
             printf("ERRO: Opcao muito longa.\n");
             overflow = 1;
@@ -987,8 +5263,9 @@ void gerarRelatorios(Cliente* clientes, int totalClientes, Veiculo* veiculos, in
         }
 
         switch (opcao) {
-            case 1: relatorioHistoricoVeiculo(veiculos, totalVeiculos, ordens, totalOrdens); break;
-            case 2: relatorioVeiculosCliente(clientes, totalClientes, veiculos, totalVeiculos); break;
+            case 1: importarTabela(oficina, IMPORTAR_CLIENTES); break;
+            case 2: importarTabela(oficina, IMPORTAR_VEICULOS); break;
+            case 3: importarTabela(oficina, IMPORTAR_ORDENS); break;
             case 0: break;
             default: printf("Opcao invalida!\n"); pausarSistema();
         }
@@ -1002,21 +5279,42 @@ void exibirManual() {
     printf("--- Manual do Usuario: Sistema de Gerenciamento de Oficina ---\n\n");
     printf("1. INTRODUCAO\n");
     printf("   Este sistema permite o cadastro e gerenciamento de clientes, veiculos e\n");
-    printf("   ordens de servico. Ele opera por menus de texto e salva todos os dados\n");
-    printf("   automaticamente ao sair.\n\n");
+    printf("   ordens de servico. Ele opera por menus de texto e grava cada alteracao\n");
+    printf("   no disco assim que ela e confirmada.\n\n");
 
     printf("2. FUNCIONAMENTO GERAL\n");
     printf("   - Para escolher uma opcao, digite o numero correspondente e pressione Enter.\n");
-    printf("   - Os dados sao carregados ao iniciar e salvos ao escolher a opcao 'Sair'.\n");
-    printf("   - Fechar a janela do terminal diretamente fara com que as alteracoes\n");
-    printf("     nao sejam salvas.\n\n");
+    printf("   - Cada alteracao e registrada no arquivo 'diario.log' na hora. Ao sair pela\n");
+    printf("     opcao 'Sair', o diario e incorporado aos arquivos .dat.\n");
+    printf("   - Se o programa for fechado de outra forma, as alteracoes do diario sao\n");
+    printf("     recuperadas automaticamente na proxima vez que ele for aberto.\n");
+    printf("   - Os arquivos .dat sao compactos e protegidos por CRC. Arquivos de versoes\n");
+    printf("     anteriores sao convertidos automaticamente na primeira abertura.\n");
+    printf("   - Na abertura, todos os registros sao conferidos. Os invalidos ou que\n");
+    printf("     apontam para cliente/veiculo inexistente vao para 'quarentena_*.csv'\n");
+    printf("     (reimportaveis pelo Menu 6) e o motivo fica em '%s'.\n", ARQUIVO_RELATORIO_INTEGRIDADE);
+    printf("   - Nao ha limite fixo de registros. A memoria usada pelos dados e limitada\n");
+    printf("     pela variavel de ambiente OFICINA_CACHE_PAGINAS (paginas de 16 KB;\n");
+    printf("     padrao %d).\n", POOL_PAGINAS_PADRAO);
+    printf("   - O sistema tambem aceita comandos sem menus, para scripts e arquivos de\n");
+    printf("     lote. Execute o programa com o argumento 'ajuda' para ver a lista.\n");
+    printf("   - Com varios balcoes, execute 'oficina servidor' na pasta dos dados. Os\n");
+    printf("     demais terminais abertos nessa pasta passam a usar o servidor: comandos\n");
+    printf("     sao repassados a ele e, sem argumentos, abre-se um terminal de comandos\n");
+    printf("     no lugar dos menus. Encerre com 'oficina servidor parar'.\n");
+    printf("   - Sem servidor, varias copias tambem podem ficar abertas na mesma pasta:\n");
+    printf("     as alteracoes de uma aparecem nas outras ao voltar a um menu, e a\n");
+    printf("     ultima a sair grava os arquivos .dat.\n\n");
 
     printf("3. GERENCIAR CLIENTES (Menu 1)\n");
     printf("   - Cadastrar: Adiciona um novo cliente. CPF deve ser unico e com 11 digitos.\n");
     printf("     Nome deve conter apenas letras e espacos.\n");
     printf("   - Atualizar: Modifica o nome e/ou telefone de um cliente existente via CPF.\n");
     printf("   - Remover: Apaga um cliente via CPF. So e permitido se o cliente nao\n");
-    printf("     possuir veiculos cadastrados.\n\n");
+    printf("     possuir veiculos cadastrados.\n");
+    printf("   - Buscar por Nome: Mostra os clientes cujo nome (ou sobrenome) comeca\n");
+    printf("     com o texto digitado e, se forem poucos, tambem os que diferem por\n");
+    printf("     pequenos erros de digitacao. Maiusculas e acentos nao importam.\n\n");
 
     printf("4. GERENCIAR VEICULOS (Menu 2)\n");
     printf("   - Cadastrar: Adiciona um novo veiculo. E necessario informar o CPF de um\n");
@@ -1028,31 +5326,826 @@ void exibirManual() {
     printf("5. GERENCIAR ORDENS DE SERVICO (Menu 3)\n");
     printf("   - Abrir: Cria uma nova ordem de servico para um veiculo cadastrado.\n");
     printf("     A ordem recebe um ID unico e o status 'AGUARDANDO AVALIACAO'.\n");
+    printf("     A data de entrada deve ser uma data valida no formato DD/MM/AAAA.\n");
     printf("   - Atualizar Status: Altera o status de uma O.S. existente (Em Reparo,\n");
     printf("     Finalizado, Entregue).\n");
-    printf("   - Listar Todas: Exibe todas as ordens de servico ja criadas.\n\n");
+    printf("   - Listar: Exibe as ordens de servico em paginas de %d. Use P e A para\n", ORDENS_POR_PAGINA);
+    printf("     navegar e F para filtrar por status, placa e periodo, ou mudar a ordem.\n");
+    printf("   - Buscar por Descricao: Lista as ordens cuja descricao contem todas as\n");
+    printf("     palavras informadas (ex.: 'freio dianteiro'). Maiusculas e acentos nao\n");
+    printf("     importam. O indice da busca fica em '%s'.\n\n", ARQUIVO_INDICE_TEXTUAL);
 
     printf("6. GERAR RELATORIOS (Menu 4)\n");
     printf("   - Gera arquivos de texto (.txt) na mesma pasta do programa.\n");
     printf("   - Relatorio 1: Pede uma placa e lista todo o historico de servicos do veiculo.\n");
     printf("   - Relatorio 2: Pede um CPF e lista todos os veiculos daquele cliente.\n\n");
+
+    printf("7. IMPORTAR DADOS (Menu 6)\n");
+    printf("   - Carrega clientes, veiculos ou ordens de um arquivo CSV (separado por\n");
+    printf("     virgulas; campos com virgula devem vir entre aspas). Importe clientes\n");
+    printf("     antes de veiculos, e veiculos antes de ordens.\n");
+    printf("   - Clientes: nome,cpf,telefone | Veiculos: placa,modelo,ano,cpf_cliente\n");
+    printf("     Ordens: placa,data_entrada,descricao[,status 0-3] (o ID e gerado).\n");
+    printf("   - As mesmas regras do cadastro valem para cada linha. Linhas rejeitadas\n");
+    printf("     e o motivo ficam em '%s'.\n\n", ARQUIVO_RELATORIO_IMPORTACAO);
     
     pausarSistema();
 }
 
+// --- Modo de Linha de Comando ---
+
+// Sem argumentos o programa abre os menus. Com argumentos ele executa um
+// comando, ou um arquivo de comandos ("lote"), sem nenhuma interacao: carrega
+// os dados uma vez, executa tudo e salva uma vez no fim. Resultados vao para
+// a saida padrao e erros para a saida de erro.
+#define COMANDO_MAX_ARGUMENTOS 32
+#define LOTE_CONFIRMACAO 1000
+
+typedef enum {
+    COMANDO_OK,
+    COMANDO_FALHOU,
+    COMANDO_USO
+} ResultadoComando;
+
+void exibirUso(FILE* saida) {
+    fprintf(saida, "Uso: oficina <comando> [argumentos]\n");
+    fprintf(saida, "  cliente cadastrar --nome NOME --cpf CPF [--telefone TELEFONE]\n");
+    fprintf(saida, "  cliente atualizar CPF [--nome NOME] [--telefone TELEFONE]\n");
+    fprintf(saida, "  cliente remover CPF\n");
+    fprintf(saida, "  cliente buscar NOME        (por inicio do nome ou aproximado; ultima coluna = distancia)\n");
+    fprintf(saida, "  veiculo cadastrar --placa PLACA --modelo MODELO --ano ANO --cpf CPF\n");
+    fprintf(saida, "  veiculo atualizar PLACA [--modelo MODELO] [--ano ANO]\n");
+    fprintf(saida, "  veiculo remover PLACA\n");
+    fprintf(saida, "  os abrir --placa PLACA [--data DD/MM/AAAA] --desc DESCRICAO\n");
+    fprintf(saida, "  os status ID STATUS        (0 aguardando, 1 em reparo, 2 finalizado, 3 entregue)\n");
+    fprintf(saida, "  os buscar PALAVRA...       (ordens cuja descricao contem todas as palavras)\n");
+    fprintf(saida, "  os resumo                  (quantidade de ordens em cada status)\n");
+    fprintf(saida, "  os listar [--status N] [--placa PLACA] [--de DATA] [--ate DATA]\n");
+    fprintf(saida, "            [--dias N] [--mais-de N] [--abertas]\n");
+    fprintf(saida, "            [--ordem id|id-desc|data|data-desc] [--pagina N] [--por-pagina N]\n");
+    fprintf(saida, "  relatorio historico PLACA\n");
+    fprintf(saida, "  relatorio veiculos CPF\n");
+    fprintf(saida, "  importar clientes|veiculos|ordens ARQUIVO.csv\n");
+    fprintf(saida, "  lote ARQUIVO               (um comando por linha; '-' le da entrada padrao)\n");
+    fprintf(saida, "  servidor                   (mantem os dados e atende os outros terminais desta pasta)\n");
+    fprintf(saida, "  servidor parar\n");
+}
+
+static const char* opcaoComando(int argc, char** argv, const char* nome) {
+    for (int i = 2; i + 1 < argc; i++) {
+        if (strcmp(argv[i], nome) == 0) return argv[i + 1];
+    }
+    return NULL;
+}
+
+// Junta os argumentos a partir do terceiro, separados por espaco (truncando
+// o que nao couber em 'destino').
+static void juntarArgumentos(int argc, char** argv, char* destino, size_t tamanho) {
+    destino[0] = '\0';
+    for (int i = 2; i < argc; i++) {
+        size_t usado = strlen(destino);
+        snprintf(destino + usado, tamanho - usado, "%s%s", i > 2 ? " " : "", argv[i]);
+    }
+}
+
+// Retorna 0 se o valor nao couber no campo.
+static int copiarArgumento(char* destino, size_t tamanho, const char* valor) {
+    if (strlen(valor) >= tamanho) return 0;
+    strcpy(destino, valor);
+    return 1;
+}
+
+// Separa uma linha de lote em argumentos, no proprio buffer. Espacos separam
+// argumentos; aspas duplas agrupam. Retorna -1 se houver argumentos demais.
+int separarArgumentos(char* linha, char** argumentos, int maximo) {
+    int total = 0;
+    char* leitura = linha;
+    for (;;) {
+        while (*leitura != '\0' && isspace((unsigned char)*leitura)) leitura++;
+        if (*leitura == '\0') return total;
+        if (total == maximo) return -1;
+        char* escrita = leitura;
+        argumentos[total++] = escrita;
+        int entreAspas = 0;
+        while (*leitura != '\0' && (entreAspas || !isspace((unsigned char)*leitura))) {
+            if (*leitura == '"') entreAspas = !entreAspas;
+            else *escrita++ = *leitura;
+            leitura++;
+        }
+        int fimLinha = *leitura == '\0';
+        *escrita = '\0';
+        if (fimLinha) return total;
+        leitura++;
+    }
+}
+
+// Sem --pagina, lista todas as paginas da consulta.
+static ResultadoComando listarOrdensTexto(Oficina* oficina, int argc, char** argv, FILE* saida, FILE* erros) {
+    FiltroOrdens filtro;
+    filtroOrdensPadrao(&filtro);
+    const char* valor;
+    if ((valor = opcaoComando(argc, argv, "--status")) != NULL) filtro.status = atoi(valor);
+    if ((valor = opcaoComando(argc, argv, "--placa")) != NULL && !copiarArgumento(filtro.placa, sizeof(filtro.placa), valor)) return COMANDO_USO;
+    if ((valor = opcaoComando(argc, argv, "--de")) != NULL && !converterData(valor, &filtro.dataInicial)) return COMANDO_USO;
+    if ((valor = opcaoComando(argc, argv, "--ate")) != NULL && !converterData(valor, &filtro.dataFinal)) return COMANDO_USO;
+    // --dias N: abertas nos ultimos N dias (hoje incluso); --mais-de N: abertas ha mais de N dias.
+    if ((valor = opcaoComando(argc, argv, "--dias")) != NULL) {
+        if (atoi(valor) <= 0) return COMANDO_USO;
+        filtro.dataInicial = dataDeHoje() - atoi(valor) + 1;
+    }
+    if ((valor = opcaoComando(argc, argv, "--mais-de")) != NULL) {
+        if (atoi(valor) < 0 || !isdigit((unsigned char)valor[0])) return COMANDO_USO;
+        filtro.dataFinal = dataDeHoje() - atoi(valor) - 1;
+    }
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--abertas") == 0) filtro.somenteAbertas = 1;
+    }
+    if ((valor = opcaoComando(argc, argv, "--ordem")) != NULL) {
+        if (strcmp(valor, "id") == 0) filtro.ordenacao = ORDENAR_ID;
+        else if (strcmp(valor, "id-desc") == 0) filtro.ordenacao = ORDENAR_ID_DESC;
+        else if (strcmp(valor, "data") == 0) filtro.ordenacao = ORDENAR_DATA;
+        else if (strcmp(valor, "data-desc") == 0) filtro.ordenacao = ORDENAR_DATA_DESC;
+        else return COMANDO_USO;
+    }
+    const char* pagina = opcaoComando(argc, argv, "--pagina");
+    const char* porPagina = opcaoComando(argc, argv, "--por-pagina");
+
+    CursorOrdens cursor;
+    cursorIniciar(&cursor, porPagina != NULL && atoi(porPagina) > 0 ? atoi(porPagina) : ORDENS_POR_PAGINA);
+    if (!consultarOrdens(oficina, &filtro, &cursor)) {
+        fprintf(erros, "%s\n", mensagemResultado(OP_SEM_MEMORIA));
+        return COMANDO_FALHOU;
+    }
+    int primeira = 0;
+    int ultima = cursorTotalPaginas(&cursor) - 1;
+    if (pagina != NULL) primeira = ultima = atoi(pagina) - 1;
+    for (cursor.pagina = primeira; cursor.pagina >= 0 && cursor.pagina <= ultima && cursor.pagina < cursorTotalPaginas(&cursor); cursor.pagina++) {
+        int inicio, fim;
+        cursorIntervaloPagina(&cursor, &inicio, &fim);
+        for (int i = inicio; i < fim; i++) {
+            OrdemServico ordem;
+            vetorLer(&oficina->ordens, cursor.itens[i].posicao, &ordem);
+            fprintf(saida, "%d\t%s\t%s\t%s\t%s\n", ordem.id, ordem.placa_veiculo, ordem.data_entrada,
+                    getStatusString(ordem.status), ordem.descricao_problema);
+        }
+    }
+    cursorLiberar(&cursor);
+    return COMANDO_OK;
+}
+
+ResultadoComando executarComando(Oficina* oficina, int argc, char** argv, FILE* saida, FILE* erros) {
+    if (argc < 2) return COMANDO_USO;
+    const char* grupo = argv[0];
+    const char* acao = argv[1];
+    const char* alvo = argc >= 3 ? argv[2] : NULL;
+    ResultadoOperacao resultado;
+
+    if (strcmp(grupo, "cliente") == 0 && strcmp(acao, "cadastrar") == 0) {
+        const char* nome = opcaoComando(argc, argv, "--nome");
+        const char* cpf = opcaoComando(argc, argv, "--cpf");
+        const char* telefone = opcaoComando(argc, argv, "--telefone");
+        if (nome == NULL || cpf == NULL) return COMANDO_USO;
+        Cliente cliente;
+        if (!copiarArgumento(cliente.nome, sizeof(cliente.nome), nome)) resultado = OP_NOME_INVALIDO;
+        else if (!copiarArgumento(cliente.cpf, sizeof(cliente.cpf), cpf)) resultado = OP_CPF_INVALIDO;
+        else if (!copiarArgumento(cliente.telefone, sizeof(cliente.telefone), telefone != NULL ? telefone : "")) resultado = OP_TELEFONE_INVALIDO;
+        else resultado = incluirCliente(oficina, &cliente);
+    } else if (strcmp(grupo, "cliente") == 0 && strcmp(acao, "atualizar") == 0 && alvo != NULL) {
+        resultado = alterarCliente(oficina, alvo, opcaoComando(argc, argv, "--nome"), opcaoComando(argc, argv, "--telefone"));
+    } else if (strcmp(grupo, "cliente") == 0 && strcmp(acao, "buscar") == 0 && alvo != NULL) {
+        char nome[NOME_CHAVE];
+        juntarArgumentos(argc, argv, nome, sizeof(nome));
+        CandidatoNome candidatos[CLIENTES_POR_BUSCA];
+        int total = buscarClientesPorNome(&oficina->clientesPorNome, nome, candidatos, CLIENTES_POR_BUSCA);
+        if (total == -1) {
+            fprintf(erros, "%s\n", mensagemResultado(OP_SEM_MEMORIA));
+            return COMANDO_FALHOU;
+        }
+        for (int i = 0; i < total; i++) {
+            Cliente cliente;
+            vetorLer(&oficina->clientes, candidatos[i].posicao, &cliente);
+            fprintf(saida, "%s\t%s\t%s\t%d\n", cliente.cpf, cliente.nome, cliente.telefone, candidatos[i].distancia);
+        }
+        return COMANDO_OK;
+    } else if (strcmp(grupo, "cliente") == 0 && strcmp(acao, "remover") == 0 && alvo != NULL) {
+        resultado = excluirCliente(oficina, alvo);
+    } else if (strcmp(grupo, "veiculo") == 0 && strcmp(acao, "cadastrar") == 0) {
+        const char* placa = opcaoComando(argc, argv, "--placa");
+        const char* modelo = opcaoComando(argc, argv, "--modelo");
+        const char* ano = opcaoComando(argc, argv, "--ano");
+        const char* cpf = opcaoComando(argc, argv, "--cpf");
+        if (placa == NULL || modelo == NULL || ano == NULL || cpf == NULL) return COMANDO_USO;
+        Veiculo veiculo;
+        veiculo.ano = atoi(ano);
+        if (!copiarArgumento(veiculo.placa, sizeof(veiculo.placa), placa)) resultado = OP_PLACA_INVALIDA;
+        else if (!copiarArgumento(veiculo.modelo, sizeof(veiculo.modelo), modelo)) resultado = OP_MODELO_INVALIDO;
+        else if (!copiarArgumento(veiculo.cpf_cliente, sizeof(veiculo.cpf_cliente), cpf)) resultado = OP_CLIENTE_NAO_ENCONTRADO;
+        else resultado = incluirVeiculo(oficina, &veiculo);
+    } else if (strcmp(grupo, "veiculo") == 0 && strcmp(acao, "atualizar") == 0 && alvo != NULL) {
+        const char* ano = opcaoComando(argc, argv, "--ano");
+        int novoAno = 0;
+        if (ano != NULL) novoAno = atoi(ano) != 0 ? atoi(ano) : -1;
+        resultado = alterarVeiculo(oficina, alvo, opcaoComando(argc, argv, "--modelo"), novoAno);
+    } else if (strcmp(grupo, "veiculo") == 0 && strcmp(acao, "remover") == 0 && alvo != NULL) {
+        resultado = excluirVeiculo(oficina, alvo);
+    } else if (strcmp(grupo, "os") == 0 && strcmp(acao, "abrir") == 0) {
+        const char* placa = opcaoComando(argc, argv, "--placa");
+        const char* data = opcaoComando(argc, argv, "--data");
+        const char* descricao = opcaoComando(argc, argv, "--desc");
+        if (placa == NULL || descricao == NULL) return COMANDO_USO;
+        char hoje[11];
+        formatarData(dataDeHoje(), hoje);
+        int id;
+        resultado = incluirOrdem(oficina, placa, data != NULL ? data : hoje, descricao, &id);
+        if (resultado == OP_OK) fprintf(saida, "OK %d\n", id);
+    } else if (strcmp(grupo, "os") == 0 && strcmp(acao, "status") == 0 && argc == 4) {
+        resultado = alterarStatusOrdem(oficina, atoi(argv[2]), isdigit((unsigned char)argv[3][0]) ? atoi(argv[3]) : -1);
+        if (resultado == OP_OK) fprintf(saida, "OK\n");
+    } else if (strcmp(grupo, "os") == 0 && strcmp(acao, "resumo") == 0) {
+        for (int s = 0; s < TOTAL_STATUS; s++) {
+            fprintf(saida, "%s\t%d\n", getStatusString((StatusOrdem)s), conjuntosContar(&oficina->ordensPorStatus, s));
+        }
+        return COMANDO_OK;
+    } else if (strcmp(grupo, "os") == 0 && strcmp(acao, "buscar") == 0 && argc > 2) {
+        char texto[COMANDO_MAX_ARGUMENTOS * (TERMO_MAXIMO + 1)];
+        juntarArgumentos(argc, argv, texto, sizeof(texto));
+        CursorOrdens cursor;
+        cursorIniciar(&cursor, ORDENS_POR_PAGINA);
+        if (!consultarOrdensPorTexto(oficina, texto, &cursor)) {
+            fprintf(erros, "%s\n", mensagemResultado(OP_SEM_MEMORIA));
+            return COMANDO_FALHOU;
+        }
+        for (int i = 0; i < cursor.total; i++) {
+            OrdemServico ordem;
+            vetorLer(&oficina->ordens, cursor.itens[i].posicao, &ordem);
+            fprintf(saida, "%d\t%s\t%s\t%s\t%s\n", ordem.id, ordem.placa_veiculo, ordem.data_entrada,
+                    getStatusString(ordem.status), ordem.descricao_problema);
+        }
+        cursorLiberar(&cursor);
+        return COMANDO_OK;
+    } else if (strcmp(grupo, "os") == 0 && strcmp(acao, "listar") == 0) {
+        return listarOrdensTexto(oficina, argc, argv, saida, erros);
+    } else if (strcmp(grupo, "relatorio") == 0 && alvo != NULL) {
+        TipoRelatorio tipo;
+        if (!relatorioPorNome(acao, &tipo)) return COMANDO_USO;
+        resultado = gravarRelatorio(oficina, tipo, alvo);
+        if (resultado == OP_OK) fprintf(saida, "OK %s\n", arquivoRelatorio(tipo));
+    } else if (strcmp(grupo, "importar") == 0 && alvo != NULL) {
+        TipoImportacao tipo;
+        if (strcmp(acao, "clientes") == 0) tipo = IMPORTAR_CLIENTES;
+        else if (strcmp(acao, "veiculos") == 0) tipo = IMPORTAR_VEICULOS;
+        else if (strcmp(acao, "ordens") == 0) tipo = IMPORTAR_ORDENS;
+        else return COMANDO_USO;
+        ResumoImportacao resumo;
+        if (!importarArquivoCSV(oficina, tipo, alvo, &resumo)) {
+            fprintf(erros, "ERRO: Nao foi possivel abrir '%s'.\n", alvo);
+            return COMANDO_FALHOU;
+        }
+        fprintf(saida, "OK %ld importadas, %ld rejeitadas (%s)\n", resumo.importadas, resumo.rejeitadas, ARQUIVO_RELATORIO_IMPORTACAO);
+        return resumo.rejeitadas == 0 ? COMANDO_OK : COMANDO_FALHOU;
+    } else {
+        return COMANDO_USO;
+    }
+
+    if (resultado != OP_OK) {
+        fprintf(erros, "%s\n", mensagemResultado(resultado));
+        return COMANDO_FALHOU;
+    }
+    if (strcmp(grupo, "cliente") == 0 || strcmp(grupo, "veiculo") == 0) fprintf(saida, "OK\n");
+    return COMANDO_OK;
+}
+
+// Quem executa cada linha de um lote: os dados locais ou o servidor.
+// 'confirmar' (opcional) e chamado a cada LOTE_CONFIRMACAO linhas.
+typedef struct {
+    ResultadoComando (*executar)(void* contexto, int argc, char** argv);
+    void (*confirmar)(void* contexto);
+    void* contexto;
+} ExecutorComandos;
+
+// Executa um comando por linha. Linhas vazias e comentarios (#) sao ignorados.
+// Retorna o numero de comandos que falharam, ou -1 se o arquivo nao abrir.
+long executarLote(const ExecutorComandos* executor, const char* caminho) {
+    LeitorLinhas leitor = { NULL, NULL, IMPORTACAO_BLOCO, 0, 0, 0, 0 };
+    leitor.arquivo = strcmp(caminho, "-") == 0 ? stdin : fopen(caminho, "r");
+    if (leitor.arquivo == NULL) return -1;
+    leitor.buffer = malloc(leitor.capacidade + 1);
+    if (leitor.buffer == NULL) {
+        printf("ERRO CRITICO: Falha ao alocar memoria para o lote!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    char* argumentos[COMANDO_MAX_ARGUMENTOS];
+    long numero = 0;
+    long falhas = 0;
+    char* linha;
+    while ((linha = leitorProximaLinha(&leitor)) != NULL) {
+        numero++;
+        int total = separarArgumentos(linha, argumentos, COMANDO_MAX_ARGUMENTOS);
+        if (total == 0 || argumentos[0][0] == '#') continue;
+
+        ResultadoComando resultado = total < 0 || strcmp(argumentos[0], "lote") == 0
+            ? COMANDO_USO : executor->executar(executor->contexto, total, argumentos);
+        if (resultado == COMANDO_USO) fprintf(stderr, "Linha %ld: comando invalido.\n", numero);
+        else if (resultado == COMANDO_FALHOU) fprintf(stderr, "Linha %ld: comando falhou.\n", numero);
+        if (resultado != COMANDO_OK) falhas++;
+        if (numero % LOTE_CONFIRMACAO == 0 && executor->confirmar != NULL) executor->confirmar(executor->contexto);
+    }
+    if (leitor.erro) {
+        fprintf(stderr, "ERRO: Leitura do lote interrompida apos a linha %ld.\n", numero);
+        falhas++;
+    }
+
+    free(leitor.buffer);
+    if (leitor.arquivo != stdin) fclose(leitor.arquivo);
+    return falhas;
+}
+
+static ResultadoComando executarLocal(void* contexto, int argc, char** argv) {
+    sincronizarOficina(contexto);
+    return executarComando(contexto, argc, argv, stdout, stderr);
+}
+
+static void confirmarLocal(void* contexto) {
+    confirmarOperacoes(contexto);
+}
+
+// --- Modo Servidor ---
+
+// Com 'oficina servidor', um unico processo fica com os dados na memoria e
+// atende os comandos acima por um socket local ('oficina.sock', na pasta dos
+// dados). Enquanto ele estiver ativo, as outras execucoes do programa na mesma
+// pasta viram clientes: comandos e lotes sao repassados ao servidor, e sem
+// argumentos abre-se um terminal de comandos no lugar dos menus. Assim varios
+// balcoes trabalham sobre os mesmos dados sem que um sobrescreva o .dat do outro.
+//
+// Cada conexao e atendida por uma thread. Consultas (buscas, listagens e
+// resumo) rodam em paralelo sob a trava de leitura; os demais comandos pegam
+// a trava de escrita, confirmam o diario e so entao a liberam. O servidor
+// grava os .dat ao encerrar ('oficina servidor parar' ou Ctrl+C) e, como no
+// uso normal, sempre que o diario passa do limite.
+//
+// Protocolo (inteiros de 32 bits, little-endian):
+//   requisicao: total de argumentos, e para cada um o tamanho e os bytes
+//   resposta:   codigo (ResultadoComando), tamanho da saida, tamanho dos
+//               erros, e em seguida os dois textos
+#define ARQUIVO_SOCKET "oficina.sock"
+#define SERVIDOR_FILA 16
+#define REQUISICAO_ARGUMENTO_MAXIMO 4096
+
+#ifndef _WIN32
+
+static int enviarBytes(int conexao, const void* dados, size_t tamanho) {
+    const char* bytes = dados;
+    while (tamanho > 0) {
+        ssize_t enviados = write(conexao, bytes, tamanho);
+        if (enviados < 0 && errno == EINTR) continue;
+        if (enviados <= 0) return 0;
+        bytes += enviados;
+        tamanho -= (size_t)enviados;
+    }
+    return 1;
+}
+
+static int receberBytes(int conexao, void* dados, size_t tamanho) {
+    char* bytes = dados;
+    while (tamanho > 0) {
+        ssize_t recebidos = read(conexao, bytes, tamanho);
+        if (recebidos < 0 && errno == EINTR) continue;
+        if (recebidos <= 0) return 0;
+        bytes += recebidos;
+        tamanho -= (size_t)recebidos;
+    }
+    return 1;
+}
+
+static int enviarU32(int conexao, unsigned int valor) {
+    unsigned char bytes[4];
+    escreverU32(bytes, valor);
+    return enviarBytes(conexao, bytes, sizeof(bytes));
+}
+
+static int receberU32(int conexao, unsigned int* valor) {
+    unsigned char bytes[4];
+    if (!receberBytes(conexao, bytes, sizeof(bytes))) return 0;
+    *valor = lerU32(bytes);
+    return 1;
+}
+
+// Retorna o socket conectado ao servidor desta pasta, ou -1 se nao houver.
+int conectarServidor() {
+    int conexao = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (conexao < 0) return -1;
+    struct sockaddr_un endereco;
+    memset(&endereco, 0, sizeof(endereco));
+    endereco.sun_family = AF_UNIX;
+    strncpy(endereco.sun_path, ARQUIVO_SOCKET, sizeof(endereco.sun_path) - 1);
+    if (connect(conexao, (struct sockaddr*)&endereco, sizeof(endereco)) != 0) {
+        close(conexao);
+        return -1;
+    }
+    return conexao;
+}
+
+void desconectarServidor(int conexao) {
+    close(conexao);
+}
+
+// Envia um comando e copia a resposta para 'saida' e 'erros'. Retorna o
+// ResultadoComando do servidor, ou -1 se a conexao cair. Cliente e servidor
+// estao sempre na mesma pasta (a do socket), entao caminhos relativos, como o
+// do 'importar', valem igual para os dois.
+int executarRemoto(int conexao, int argc, char** argv, FILE* saida, FILE* erros) {
+    if (!enviarU32(conexao, (unsigned int)argc)) return -1;
+    for (int i = 0; i < argc; i++) {
+        size_t tamanho = strlen(argv[i]);
+        if (!enviarU32(conexao, (unsigned int)tamanho) || !enviarBytes(conexao, argv[i], tamanho)) return -1;
+    }
+
+    unsigned int codigo, tamanhos[2];
+    if (!receberU32(conexao, &codigo) || !receberU32(conexao, &tamanhos[0]) || !receberU32(conexao, &tamanhos[1])) return -1;
+    FILE* destinos[2] = { saida, erros };
+    char bloco[4096];
+    for (int i = 0; i < 2; i++) {
+        while (tamanhos[i] > 0) {
+            size_t parte = tamanhos[i] < sizeof(bloco) ? tamanhos[i] : sizeof(bloco);
+            if (!receberBytes(conexao, bloco, parte)) return -1;
+            fwrite(bloco, 1, parte, destinos[i]);
+            tamanhos[i] -= (unsigned int)parte;
+        }
+    }
+    return codigo <= COMANDO_USO ? (int)codigo : -1;
+}
+
+typedef struct {
+    Oficina oficina;
+    pthread_rwlock_t trava;
+    Trava relatorios;   // so entre relatorios do mesmo arquivo; nao bloqueia alteracoes
+    int socket;
+} Servidor;
+
+typedef struct {
+    Servidor* servidor;
+    int conexao;
+} ConexaoServidor;
+
+static volatile sig_atomic_t servidorEncerrar = 0;
+
+static void pedirEncerramento(int sinal) {
+    (void)sinal;
+    servidorEncerrar = 1;
+}
+
+static int comandoSomenteLeitura(int argc, char** argv) {
+    if (argc < 2) return 0;
+    if (strcmp(argv[0], "cliente") == 0) return strcmp(argv[1], "buscar") == 0;
+    if (strcmp(argv[0], "os") == 0) {
+        return strcmp(argv[1], "buscar") == 0 || strcmp(argv[1], "listar") == 0 || strcmp(argv[1], "resumo") == 0;
+    }
+    return 0;
+}
+
+// Chamada com a trava de escrita obtida; nenhum comando roda depois disso.
+static void encerrarServidor(Servidor* servidor) {
+    close(servidor->socket);
+    unlink(ARQUIVO_SOCKET);
+    if (checkpointOficina(&servidor->oficina)) {
+        printf("Dados salvos. Servidor encerrado.\n");
+    } else {
+        printf("Alteracoes mantidas no diario '%s'. Servidor encerrado.\n", ARQUIVO_DIARIO);
+    }
+    fflush(stdout);
+}
+
+static int responder(int conexao, ResultadoComando resultado, const char* saida, size_t tamanhoSaida, const char* erros, size_t tamanhoErros) {
+    return enviarU32(conexao, (unsigned int)resultado) && enviarU32(conexao, (unsigned int)tamanhoSaida) &&
+           enviarU32(conexao, (unsigned int)tamanhoErros) && enviarBytes(conexao, saida, tamanhoSaida) &&
+           enviarBytes(conexao, erros, tamanhoErros);
+}
+
+// Retorna com a trava de leitura obtida. Se outras instancias alteraram os
+// dados, antes aplica as alteracoes com a trava de escrita.
+static void obterLeitura(Servidor* servidor) {
+    pthread_rwlock_rdlock(&servidor->trava);
+    if (oficinaDesatualizada(&servidor->oficina)) {
+        pthread_rwlock_unlock(&servidor->trava);
+        pthread_rwlock_wrlock(&servidor->trava);
+        sincronizarOficina(&servidor->oficina);
+        nomesOrganizar(&servidor->oficina.clientesPorNome);
+        pthread_rwlock_unlock(&servidor->trava);
+        pthread_rwlock_rdlock(&servidor->trava);
+    }
+}
+
+// Executa um comando recebido. Retorna 0 se a conexao deve ser fechada.
+static int atenderComando(Servidor* servidor, int conexao, int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[0], "servidor") == 0 && strcmp(argv[1], "parar") == 0) {
+        pthread_rwlock_wrlock(&servidor->trava);
+        encerrarServidor(servidor);
+        const char* mensagem = "OK\n";
+        responder(conexao, COMANDO_OK, mensagem, strlen(mensagem), "", 0);
+        exit(EXIT_SUCCESS);
+    }
+
+    char* textoSaida = NULL;
+    char* textoErros = NULL;
+    size_t tamanhoSaida = 0, tamanhoErros = 0;
+    FILE* saida = open_memstream(&textoSaida, &tamanhoSaida);
+    FILE* erros = open_memstream(&textoErros, &tamanhoErros);
+    if (saida == NULL || erros == NULL) {
+        if (saida != NULL) fclose(saida);
+        if (erros != NULL) fclose(erros);
+        free(textoSaida);
+        free(textoErros);
+        const char* mensagem = mensagemResultado(OP_SEM_MEMORIA);
+        return responder(conexao, COMANDO_FALHOU, "", 0, mensagem, strlen(mensagem));
+    }
+
+    ResultadoComando resultado;
+    TipoRelatorio tipoRelatorio;
+    if (strcmp(argv[0], "lote") == 0 || strcmp(argv[0], "servidor") == 0) {
+        resultado = COMANDO_USO;
+    } else if (argc >= 3 && strcmp(argv[0], "relatorio") == 0 && relatorioPorNome(argv[1], &tipoRelatorio)) {
+        // A trava de leitura fica obtida so durante a foto.
+        FotoRelatorio foto;
+        obterLeitura(servidor);
+        ResultadoOperacao operacao = fotografarRelatorio(&servidor->oficina, tipoRelatorio, argv[2], &foto);
+        pthread_rwlock_unlock(&servidor->trava);
+        if (operacao == OP_OK) {
+            travaObter(&servidor->relatorios);
+            operacao = escreverRelatorio(&foto);
+            travaLiberar(&servidor->relatorios);
+        }
+        if (operacao == OP_OK) {
+            fprintf(saida, "OK %s\n", arquivoRelatorio(tipoRelatorio));
+            resultado = COMANDO_OK;
+        } else {
+            fprintf(erros, "%s\n", mensagemResultado(operacao));
+            resultado = COMANDO_FALHOU;
+        }
+    } else if (comandoSomenteLeitura(argc, argv)) {
+        obterLeitura(servidor);
+        resultado = executarComando(&servidor->oficina, argc, argv, saida, erros);
+        pthread_rwlock_unlock(&servidor->trava);
+    } else {
+        pthread_rwlock_wrlock(&servidor->trava);
+        resultado = executarComando(&servidor->oficina, argc, argv, saida, erros);
+        confirmarOperacoes(&servidor->oficina);
+        // A busca por nome organiza o indice na primeira consulta; feito aqui,
+        // as consultas concorrentes so leem.
+        nomesOrganizar(&servidor->oficina.clientesPorNome);
+        pthread_rwlock_unlock(&servidor->trava);
+    }
+
+    fclose(saida);
+    fclose(erros);
+    int enviado = responder(conexao, resultado, textoSaida, tamanhoSaida, textoErros, tamanhoErros);
+    free(textoSaida);
+    free(textoErros);
+    return enviado;
+}
+
+static ROTINA_THREAD atenderConexao(void* argumento) {
+    ConexaoServidor* conexao = argumento;
+    char* argumentos[COMANDO_MAX_ARGUMENTOS];
+    unsigned int total;
+    while (receberU32(conexao->conexao, &total) && total > 0 && total <= COMANDO_MAX_ARGUMENTOS) {
+        unsigned int lidos = 0;
+        int integra = 1;
+        for (; lidos < total && integra; lidos++) {
+            unsigned int tamanho;
+            integra = receberU32(conexao->conexao, &tamanho) && tamanho <= REQUISICAO_ARGUMENTO_MAXIMO &&
+                      (argumentos[lidos] = malloc(tamanho + 1)) != NULL;
+            if (!integra) break;
+            integra = receberBytes(conexao->conexao, argumentos[lidos], tamanho);
+            argumentos[lidos][tamanho] = '\0';
+        }
+        if (integra) integra = atenderComando(conexao->servidor, conexao->conexao, (int)total, argumentos);
+        for (unsigned int i = 0; i < lidos; i++) free(argumentos[i]);
+        if (!integra) break;
+    }
+    close(conexao->conexao);
+    free(conexao);
+    return 0;
+}
+
+// Codigo de saida como em executarLinhaDeComando.
+int executarServidor() {
+    modoInterativo = 0;
+    int existente = conectarServidor();
+    if (existente >= 0) {
+        desconectarServidor(existente);
+        fprintf(stderr, "ERRO: Ja existe um servidor ativo nesta pasta.\n");
+        return 1;
+    }
+
+    static Servidor servidor;
+    carregarOficina(&servidor.oficina);
+    nomesOrganizar(&servidor.oficina.clientesPorNome);
+    pthread_rwlock_init(&servidor.trava, NULL);
+    travaIniciar(&servidor.relatorios);
+
+    struct sockaddr_un endereco;
+    memset(&endereco, 0, sizeof(endereco));
+    endereco.sun_family = AF_UNIX;
+    strncpy(endereco.sun_path, ARQUIVO_SOCKET, sizeof(endereco.sun_path) - 1);
+    // Um oficina.sock que sobrou de um servidor derrubado nao aceita conexoes.
+    unlink(ARQUIVO_SOCKET);
+    servidor.socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (servidor.socket < 0 || bind(servidor.socket, (struct sockaddr*)&endereco, sizeof(endereco)) != 0 ||
+        listen(servidor.socket, SERVIDOR_FILA) != 0) {
+        fprintf(stderr, "ERRO: Nao foi possivel criar o socket '%s'.\n", ARQUIVO_SOCKET);
+        liberarOficina(&servidor.oficina);
+        return 1;
+    }
+
+    // Sem SA_RESTART, para que o accept seja interrompido pelo sinal. As
+    // threads das conexoes nascem com os sinais bloqueados, para que eles
+    // sempre cheguem a esta thread.
+    sigset_t sinais, anteriores;
+    sigemptyset(&sinais);
+    sigaddset(&sinais, SIGINT);
+    sigaddset(&sinais, SIGTERM);
+    struct sigaction acao;
+    memset(&acao, 0, sizeof(acao));
+    acao.sa_handler = pedirEncerramento;
+    sigemptyset(&acao.sa_mask);
+    sigaction(SIGINT, &acao, NULL);
+    sigaction(SIGTERM, &acao, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Servidor ativo em '%s'. Use 'oficina servidor parar' ou Ctrl+C para encerrar.\n", ARQUIVO_SOCKET);
+    fflush(stdout);
+    while (!servidorEncerrar) {
+        int cliente = accept(servidor.socket, NULL, NULL);
+        if (cliente < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "ERRO: Falha ao aceitar conexao.\n");
+            break;
+        }
+        ConexaoServidor* conexao = malloc(sizeof(ConexaoServidor));
+        Thread thread;
+        if (conexao != NULL) {
+            conexao->servidor = &servidor;
+            conexao->conexao = cliente;
+        }
+        pthread_sigmask(SIG_BLOCK, &sinais, &anteriores);
+        int iniciada = conexao != NULL && threadIniciar(&thread, atenderConexao, conexao);
+        pthread_sigmask(SIG_SETMASK, &anteriores, NULL);
+        if (!iniciada) {
+            close(cliente);
+            free(conexao);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    pthread_rwlock_wrlock(&servidor.trava);
+    encerrarServidor(&servidor);
+    return 0;
+}
+
+#else
+
+// Sem sockets locais no Windows: o programa sempre trabalha sobre os arquivos.
+int conectarServidor() {
+    return -1;
+}
+
+void desconectarServidor(int conexao) {
+    (void)conexao;
+}
+
+int executarRemoto(int conexao, int argc, char** argv, FILE* saida, FILE* erros) {
+    (void)conexao; (void)argc; (void)argv; (void)saida; (void)erros;
+    return -1;
+}
+
+int executarServidor() {
+    fprintf(stderr, "ERRO: O modo servidor nao esta disponivel no Windows.\n");
+    return 1;
+}
+
+#endif
+
+static ResultadoComando executarNoServidor(void* contexto, int argc, char** argv) {
+    int codigo = executarRemoto(*(int*)contexto, argc, argv, stdout, stderr);
+    if (codigo < 0) {
+        fprintf(stderr, "ERRO: Conexao com o servidor perdida.\n");
+        return COMANDO_FALHOU;
+    }
+    return (ResultadoComando)codigo;
+}
+
+// Terminal de comandos usado no lugar dos menus quando ha um servidor ativo.
+// As linhas seguem o formato dos lotes.
+void terminalRemoto(int conexao) {
+    char linha[1024];
+    char* argumentos[COMANDO_MAX_ARGUMENTOS];
+    limparTela();
+    printf("--- Sistema de Gerenciamento de Oficina (conectado ao servidor) ---\n");
+    printf("Digite 'ajuda' para ver os comandos e 'sair' para encerrar.\n");
+    for (;;) {
+        printf("oficina> ");
+        fflush(stdout);
+        if (fgets(linha, sizeof(linha), stdin) == NULL) break;
+        if (strchr(linha, '\n') == NULL && !feof(stdin)) {
+            limparBuffer();
+            printf("ERRO: Linha muito longa.\n");
+            continue;
+        }
+        linha[strcspn(linha, "\n")] = '\0';
+        int total = separarArgumentos(linha, argumentos, COMANDO_MAX_ARGUMENTOS);
+        if (total == 0) continue;
+        if (total < 0) {
+            printf("ERRO: Argumentos demais.\n");
+            continue;
+        }
+        if (strcmp(argumentos[0], "sair") == 0) break;
+        if (strcmp(argumentos[0], "ajuda") == 0) {
+            exibirUso(stdout);
+            continue;
+        }
+        int codigo = strcmp(argumentos[0], "lote") == 0 ? COMANDO_USO : executarRemoto(conexao, total, argumentos, stdout, stdout);
+        if (codigo < 0) {
+            printf("ERRO: Conexao com o servidor perdida.\n");
+            break;
+        }
+        if (codigo == COMANDO_USO) printf("Comando invalido. Digite 'ajuda' para ver os comandos.\n");
+    }
+    fflush(stdout);
+}
+
+// Codigo de saida: 0 se tudo deu certo, 1 se algum comando falhou ou os
+// dados nao puderam ser salvos, 2 se o comando for invalido.
+static int codigoDoLote(long falhas, const char* caminho) {
+    if (falhas < 0) {
+        fprintf(stderr, "ERRO: Nao foi possivel abrir o lote '%s'.\n", caminho);
+        return 1;
+    }
+    return falhas > 0;
+}
+
+int executarLinhaDeComando(int argc, char** argv) {
+    modoInterativo = 0;
+    if (strcmp(argv[0], "ajuda") == 0 || strcmp(argv[0], "--help") == 0) {
+        exibirUso(stdout);
+        return 0;
+    }
+    if (strcmp(argv[0], "servidor") == 0 && argc == 1) return executarServidor();
+
+    int codigo = 0;
+    int conexao = conectarServidor();
+    if (conexao >= 0) {
+        if (strcmp(argv[0], "lote") == 0) {
+            ExecutorComandos executor = { executarNoServidor, NULL, &conexao };
+            codigo = argc == 2 ? codigoDoLote(executarLote(&executor, argv[1]), argv[1]) : 2;
+        } else {
+            codigo = executarNoServidor(&conexao, argc, argv);
+        }
+        if (codigo == 2) exibirUso(stderr);
+        desconectarServidor(conexao);
+        return codigo;
+    }
+    if (strcmp(argv[0], "servidor") == 0 && argc == 2 && strcmp(argv[1], "parar") == 0) {
+        fprintf(stderr, "ERRO: Nenhum servidor ativo nesta pasta.\n");
+        return 1;
+    }
+
+    Oficina oficina;
+    carregarOficina(&oficina);
+
+    if (strcmp(argv[0], "lote") == 0) {
+        ExecutorComandos executor = { executarLocal, confirmarLocal, &oficina };
+        codigo = argc == 2 ? codigoDoLote(executarLote(&executor, argv[1]), argv[1]) : 2;
+    } else {
+        ResultadoComando resultado = executarComando(&oficina, argc, argv, stdout, stderr);
+        if (resultado == COMANDO_USO) codigo = 2;
+        else if (resultado == COMANDO_FALHOU) codigo = 1;
+    }
+    if (codigo == 2) exibirUso(stderr);
+
+    if (!checkpointOficina(&oficina)) {
+        fprintf(stderr, "Alteracoes mantidas no diario '%s'.\n", ARQUIVO_DIARIO);
+        if (codigo == 0) codigo = 1;
+    }
+    liberarOficina(&oficina);
+    return codigo;
+}
+
+
 // --- Funcao Principal ---
 
 void menuPrincipal() {
-    Cliente* clientes = NULL;
-    int totalClientes = 0;
-    Veiculo* veiculos = NULL;
-    int totalVeiculos = 0;
-    OrdemServico* ordens = NULL;
-    int totalOrdens = 0;
-
-    carregarDados("clientes.dat", (void**)&clientes, &totalClientes, sizeof(Cliente));
-    carregarDados("veiculos.dat", (void**)&veiculos, &totalVeiculos, sizeof(Veiculo));
-    carregarDados("ordens.dat", (void**)&ordens, &totalOrdens, sizeof(OrdemServico));
+    iniciarTela();
+    int conexao = conectarServidor();
+    if (conexao >= 0) {
+        terminalRemoto(conexao);
+        desconectarServidor(conexao);
+        return;
+    }
+    Oficina oficina;
+    carregarOficina(&oficina);
 
     int opcao = -1;
     char buffer[10];
@@ -1065,6 +6158,7 @@ void menuPrincipal() {
         printf("3. Gerenciar Ordens de Servico\n");
         printf("4. Gerar Relatorios\n");
         printf("5. Manual do Usuario\n");
+        printf("6. Importar Dados (CSV)\n");
         printf("0. Sair\n");
         printf("Escolha uma opcao: ");
         
@@ -1083,16 +6177,18 @@ void menuPrincipal() {
         }
 
         switch (opcao) {
-            case 1: gerenciarClientes(&clientes, &totalClientes, veiculos, totalVeiculos); break;
-            case 2: gerenciarVeiculos(&veiculos, &totalVeiculos, clientes, totalClientes, ordens, totalOrdens); break;
-            case 3: gerenciarOrdens(&ordens, &totalOrdens, veiculos, totalVeiculos); break;
-            case 4: gerarRelatorios(clientes, totalClientes, veiculos, totalVeiculos, ordens, totalOrdens); break;
+            case 1: gerenciarClientes(&oficina); break;
+            case 2: gerenciarVeiculos(&oficina); break;
+            case 3: gerenciarOrdens(&oficina); break;
+            case 4: gerarRelatorios(&oficina); break;
             case 5: exibirManual(); break;
+            case 6: importarDados(&oficina); break;
             case 0:
-                salvarClientes(clientes, totalClientes);
-                salvarVeiculos(veiculos, totalVeiculos);
-                salvarOrdens(ordens, totalOrdens);
-                printf("Dados salvos. Saindo do sistema...\n");
+                if (checkpointOficina(&oficina)) {
+                    printf("Dados salvos. Saindo do sistema...\n");
+                } else {
+                    printf("Alteracoes mantidas no diario '%s'. Saindo do sistema...\n", ARQUIVO_DIARIO);
+                }
                 break;
             default:
                 printf("Opcao invalida!\n");
@@ -1100,12 +6196,11 @@ void menuPrincipal() {
         }
     } while (opcao != 0);
 
-    free(clientes);
-    free(veiculos);
-    free(ordens);
+    liberarOficina(&oficina);
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1) return executarLinhaDeComando(argc - 1, argv + 1);
     menuPrincipal();
     return 0;
 